@@ -1,35 +1,181 @@
 #ifndef AUTH_HANDLER_H
 #define AUTH_HANDLER_H
 
+#include "http_client.h"
+#include "session_cache.h"
+#include "session_signature.h"
 #include <string>
 #include <ctime>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 struct AuthResult {
     bool success;
     std::string message;
     std::string sessionToken;
     std::time_t expiresAt;
+    // Hex Ed25519 signature over the session; empty if the server does not
+    // sign sessions.
+    std::string signature;
 };
 
+// Safe to share between threads. Session state is an immutable snapshot
+// replaced as a whole under a mutex and read without taking it, so
+// IsAuthenticated, GetUsername and GetExpiresAt never wait on a request.
+// Concurrent session checks share one request. Setters are configuration:
+// call them before the handler is shared.
 class AuthHandler {
 private:
-    std::string currentSessionToken;
-    std::string currentUsername;
-    bool isAuthenticated;
+    struct SessionState {
+        std::string token;
+        std::string username;
+        std::time_t expiresAt = 0;
+        std::time_t lastVerifiedAt = 0;
+        std::string signature;
+        // expiresAt at the time the signature checked out; 0 if it did not.
+        std::time_t signedExpiresAt = 0;
+    };
+    // One /check-session request and every caller waiting on it.
+    struct SessionCheck;
+
+    // Serialises writers of `session`; readers use std::atomic_load.
+    std::mutex stateMutex;
+    std::shared_ptr<const SessionState> session;
+    std::atomic<bool> isAuthenticated;
+    std::atomic<unsigned long long> localSessionChecks;
+    std::atomic<unsigned long long> coalescedSessionChecks;
+
+    std::mutex checkMutex;
+    std::shared_ptr<SessionCheck> checkInFlight;
+    // Token of the last session the server confirmed, and until when that
+    // answer is reused (SESSION_CHECK_CACHE_MS).
+    std::string checkCachedToken;
+    std::chrono::steady_clock::time_point checkCachedUntil;
+
+    bool persistSession;
+    bool hedgeCheckSession;
+    HTTPClient httpClient;
+    SessionCache sessionCache;
+    const SessionVerifier* sessionVerifier;
+    std::string hardwareId;
+    std::string baseUrl;
+    std::string validateEndpoint;
+    std::string checkSessionEndpoint;
+    std::string logoutEndpoint;
     
-    std::string GenerateHWID();
+    static std::string GenerateHWID();
     std::string EncryptKey(const std::string& key);
     bool VerifyIntegrity();
+    
+    // `requestData` refers to `username` and `encryptedKey`.
+    bool BuildValidateRequest(const std::string& username, const std::string& key, std::string& encryptedKey,
+                              RequestBody& requestData, AuthResult& result);
+    static AuthResult ParseValidateResponse(const HTTPResponse& response);
+    AuthResult HandleValidateResponse(const std::string& username, const HTTPResponse& response);
+    std::shared_ptr<const SessionState> CurrentSession() const;
+    // Publishes `next`; the caller holds stateMutex.
+    void PublishSession(std::shared_ptr<SessionState> next);
+    // Refers to `state`, which must outlive the request body.
+    RequestBody BuildSessionRequest(const SessionState& state) const;
+    bool HandleCheckSessionResponse(const std::string& token, const HTTPResponse& response);
+    void AdoptSignature(SessionState& state) const;
+    bool CheckSessionLocally(const SessionState& state);
+    void SendSessionCheck(const std::shared_ptr<const SessionState>& state, const OperationContext& context,
+                          std::function<void(bool)> callback);
+    void FinishSessionCheck(const std::shared_ptr<SessionCheck>& check, const std::string& token, bool valid);
+    void PersistSession(const SessionState& state);
+    void ClearSessionState();
 
 public:
     AuthHandler();
+    explicit AuthHandler(const std::string& apiBaseUrl);
     ~AuthHandler();
     
-    AuthResult ValidateKey(const std::string& username, const std::string& key);
-    bool CheckSession();
-    void Logout();
+    // Every network call takes an optional context: cancelling its token or
+    // passing its deadline fails the call as a network error, which leaves
+    // the current session untouched.
+    AuthResult ValidateKey(const std::string& username, const std::string& key,
+                           const OperationContext& context = OperationContext());
+    // Answers from the session signature when it verifies, the server
+    // confirmed the session within SESSION_LOCAL_CHECK_MAX_AGE and it has
+    // more than SESSION_LOCAL_CHECK_MIN_REMAINING left; asks the server
+    // otherwise. Callers that arrive while a check is in flight wait for its
+    // answer instead of sending their own, and a confirmation is reused for
+    // SESSION_CHECK_CACHE_MS.
+    //
+    // Never blocks on the HTTP event loop thread: there it answers from the
+    // signature or the cached confirmation if it can, and otherwise returns
+    // IsAuthenticated() while a shared check starts in the background.
+    // Completion callbacks that need the server's answer should use
+    // CheckSessionAsync instead.
+    bool CheckSession(const OperationContext& context = OperationContext());
+    
+    // Asynchronous variants. Results are delivered on the HTTP event loop
+    // thread; the handler must outlive any request it has in flight.
+    void ValidateKeyAsync(const std::string& username, const std::string& key,
+                          std::function<void(const AuthResult&)> callback,
+                          const OperationContext& context = OperationContext());
+    std::future<AuthResult> ValidateKeyAsync(const std::string& username, const std::string& key);
+    // Checks a username/key pair without adopting or persisting the session,
+    // for tools that validate many licenses through one handler.
+    void ValidateCredentialsAsync(const std::string& username, const std::string& key,
+                                  std::function<void(const AuthResult&)> callback,
+                                  const OperationContext& context = OperationContext());
+    void CheckSessionAsync(std::function<void(bool)> callback,
+                           const OperationContext& context = OperationContext());
+    std::future<bool> CheckSessionAsync();
+    
+    // Clears the local session even if the server cannot be told in time.
+    void Logout(const OperationContext& context = OperationContext());
+
+    // Opens and caches a connection to the API host so the next call skips
+    // DNS, TCP and TLS setup. Sends no credentials.
+    bool Preconnect(const OperationContext& context = OperationContext());
+    
+    // Restores the session saved by a previous launch. Succeeds without any
+    // network call if the server confirmed it within SESSION_RESUME_OFFLINE_GRACE,
+    // otherwise confirms it with a single CheckSession.
+    bool ResumeSession(const OperationContext& context = OperationContext());
+    void ResumeSessionAsync(std::function<void(bool)> callback,
+                            const OperationContext& context = OperationContext());
+    
+    // Tools that create throwaway sessions (benchmarks, load tests) turn this
+    // off so they never touch the user's resume file. Defaults to
+    // SESSION_RESUME_ENABLED.
+    void SetSessionPersistence(bool enabled);
+    // Preferred body encoding; see HTTPClient::SetWireFormat.
+    void SetWireFormat(WireFormat preferred);
+    // See HTTPClient::SetHttpVersion.
+    void SetHttpVersion(HTTPVersion version);
+    // Sends session checks with HTTPClient::PostHedged. Never applies to
+    // ValidateKey or Logout, which are not safe to send twice. Defaults to
+    // HEDGE_CHECK_SESSION.
+    void SetHedging(bool enabled);
+    HedgeStats GetHedgeStats() const;
+    // Other base URLs serving the same API; requests then go to whichever
+    // is fastest and healthy (see HTTPClient::SetMirrors). Defaults to
+    // API_MIRROR_BASE_URLS. Call before issuing requests.
+    void SetMirrors(const std::vector<std::string>& mirrorBaseUrls);
+    std::vector<MirrorStats> GetMirrorStats() const;
+    // Key used to check session signatures; nullptr turns local checks off.
+    // Defaults to SessionVerifier::Instance(). Must outlive the handler.
+    void SetSessionVerifier(const SessionVerifier* verifier);
+    // Session checks answered without a request.
+    unsigned long long GetLocalSessionChecks() const;
+    // Session checks that waited on another caller's request.
+    unsigned long long GetCoalescedSessionChecks() const;
+    // Identifies this machine to the server. Computed once per process; the
+    // GUI asks for it while the window is still being created.
+    static const std::string& HardwareId();
     bool IsAuthenticated() const;
     std::string GetUsername() const;
+    // Server-reported session expiry; 0 when unknown or not logged in.
+    std::time_t GetExpiresAt() const;
 };
 
 #endif
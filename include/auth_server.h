@@ -0,0 +1,48 @@
+#ifndef AUTH_SERVER_H
+#define AUTH_SERVER_H
+
+#include "auth_service.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AuthServerConfig {
+    std::string bindAddress = "0.0.0.0";
+    int port = 8080;
+    // Event loops to run; 0 means one per online CPU.
+    unsigned threads = 0;
+    int idleTimeoutSec = 30;
+    size_t maxHeaderBytes = 16 * 1024;
+    size_t maxBodyBytes = 1024 * 1024;
+};
+
+// Native HTTP/1.1 front end for AuthService. Runs one epoll event loop per
+// thread, each with its own SO_REUSEPORT listening socket so the kernel
+// spreads new connections across loops without a shared accept lock.
+// Connections are keep-alive and requests may be pipelined. Linux only.
+class AuthServer {
+private:
+    struct Connection;
+    class EventLoop;
+
+    AuthServerConfig config;
+    AuthService& service;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    std::vector<std::thread> threads;
+    std::atomic<bool> running{false};
+
+public:
+    AuthServer(const AuthServerConfig& serverConfig, AuthService& authService);
+    ~AuthServer();
+
+    // Binds every loop's socket; returns false with a message on failure.
+    bool Start(std::string& error);
+    void Stop();
+    void Wait();
+
+    unsigned LoopCount() const;
+};
+
+#endif
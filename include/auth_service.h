@@ -0,0 +1,80 @@
+#ifndef AUTH_SERVICE_H
+#define AUTH_SERVICE_H
+
+#include "auth_store.h"
+#include "session_signature.h"
+#include "wire_format.h"
+#include <ctime>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+struct AuthServiceConfig {
+    std::string pathPrefix = "/api";
+    long sessionTtl = 3600;
+    // Stand-in mode for tests and benchmarks: every username/key pair is
+    // accepted and gets a fresh session.
+    bool acceptAny = false;
+    // Where AuthStore keeps its snapshot and log; empty keeps everything in
+    // memory.
+    std::string dataDir;
+    // Ed25519 private key (PEM) used to sign sessions so clients can check
+    // them locally; empty leaves sessions unsigned.
+    std::string signingKeyFile;
+};
+
+struct ServiceResponse {
+    int status;
+    std::string body;
+    WireFormat format;
+};
+
+// Server side of the protocol AuthHandler speaks: /validate, /check-session,
+// /check-session/batch and /logout over POST. Bodies are JSON, CBOR or
+// MessagePack per Content-Type, and responses use the best format the
+// client's Accept header allows. Licenses are bound
+// to the first hardware ID that uses them. Thread-safe; state lives in a
+// sharded AuthStore so event loops rarely contend.
+class AuthService {
+private:
+    AuthServiceConfig config;
+    AuthStore store;
+    SessionSigner signer;
+
+    static std::string NewSessionToken();
+    void SignSession(json& result, const std::string& username, const std::string& hwid,
+                     std::time_t expiresAt, const std::string& token) const;
+
+    json Validate(const json& request);
+    json CheckSession(const json& request);
+    json CheckSessionBatch(const json& request);
+    json Logout(const json& request);
+    // Looks up session_token for username; when the request carries an hwid
+    // it must be the one the session was issued to.
+    bool IsSessionValid(const json& request, std::time_t& expiresAt);
+
+public:
+    explicit AuthService(const AuthServiceConfig& serviceConfig);
+
+    // Loads persisted state from config.dataDir and the signing key from
+    // config.signingKeyFile, if set.
+    bool Open(std::string& error);
+    bool Snapshot(std::string& error);
+    void Sync();
+
+    void AddLicense(const std::string& username, const std::string& keyHash, std::time_t expiresAt);
+    // Lines are "username key [expires_at]". A key written as "sha256:<hex>"
+    // is stored as is; anything else is hashed the way the client hashes it.
+    bool LoadLicenses(const std::string& path, std::string& error);
+    size_t LicenseCount();
+    size_t SessionCount();
+    size_t PurgeExpiredSessions();
+
+    ServiceResponse Handle(const std::string& method, const std::string& path, const std::string& contentType,
+                           const std::string& accept, const std::string& body);
+
+    static std::string HashKey(const std::string& key);
+};
+
+#endif
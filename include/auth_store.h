@@ -0,0 +1,123 @@
+#ifndef AUTH_STORE_H
+#define AUTH_STORE_H
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Fixed-size binary SHA-256 value. Keys, hardware IDs and session tokens are
+// all stored this way instead of as 64-character hex strings.
+struct Digest {
+    uint8_t bytes[32];
+
+    bool operator==(const Digest& other) const;
+    bool operator!=(const Digest& other) const { return !(*this == other); }
+    bool IsZero() const;
+
+    // Decodes a 64-character hex value (what EncryptKey and GenerateHWID
+    // produce); anything else is hashed with SHA-256.
+    static Digest FromValue(const std::string& value);
+    // Always SHA-256 of the value, for free-form strings such as usernames.
+    static Digest Hash(const std::string& value);
+    std::string ToHex() const;
+};
+
+// On-disk and in-memory record layouts; both are written verbatim to the log
+// and the snapshot, so they must stay trivially copyable with no padding.
+struct LicenseRecord {
+    Digest key;         // SHA-256 of the license key
+    Digest username;    // SHA-256 of the username
+    Digest hwid;        // bound hardware ID, all zero until first use
+    int64_t expiresAt;  // 0 = never
+};
+
+struct SessionRecord {
+    Digest key;         // session token
+    Digest username;
+    Digest hwid;        // hardware ID the session was issued to
+    int64_t expiresAt;
+};
+
+enum class LicenseStatus {
+    Ok,
+    NotFound,
+    Expired,
+    HwidMismatch
+};
+
+// Sharded open-addressing tables for licenses and sessions. Every shard has
+// its own lock; a digest's shard and probe position come straight from its
+// bytes since SHA-256 output is already uniformly distributed.
+//
+// Durability: each change is appended to log.<generation> in the data
+// directory before the shard lock is released. Snapshot() rotates to a new
+// log generation, writes every live record to snapshot.bin and deletes the
+// older logs. Open() maps the snapshot, loads shards in parallel and then
+// replays the remaining logs, truncating a torn final record. Log records are
+// whole-record writes, so replaying ones already captured by the snapshot is
+// harmless. With no data directory the store is memory only.
+class AuthStore {
+private:
+    struct LicenseShard;
+    struct SessionShard;
+
+    static const size_t SHARD_COUNT = 64;
+
+    std::unique_ptr<LicenseShard[]> licenseShards;
+    std::unique_ptr<SessionShard[]> sessionShards;
+
+    std::string dataDir;
+    std::mutex logMutex;
+    int logFd;
+    uint64_t logGeneration;
+
+    static size_t ShardFor(const Digest& key);
+
+    std::string LogPath(uint64_t generation) const;
+    std::string SnapshotPath() const;
+    bool LoadSnapshot(std::string& error);
+    bool ReplayLog(uint64_t generation, bool& found, std::string& error);
+    bool OpenLog(std::string& error);
+    void AppendLog(uint32_t type, const void* record, size_t length);
+
+    void ApplyLicense(const LicenseRecord& record);
+    void ApplySession(const SessionRecord& record);
+    void ApplySessionErase(const Digest& token);
+
+public:
+    AuthStore();
+    ~AuthStore();
+
+    AuthStore(const AuthStore&) = delete;
+    AuthStore& operator=(const AuthStore&) = delete;
+
+    // Loads and starts logging to `directory`, creating it if needed.
+    bool Open(const std::string& directory, std::string& error);
+    bool IsPersistent() const { return !dataDir.empty(); }
+
+    // Adds or updates a license, keeping an existing hardware binding for the
+    // same user. Returns false when nothing changed, which keeps reloading
+    // the same license file from growing the log.
+    bool UpsertLicense(const Digest& key, const Digest& username, std::time_t expiresAt);
+    // Checks a login and binds the license to `hwid` on first use.
+    LicenseStatus ClaimLicense(const Digest& key, const Digest& username, const Digest& hwid, std::time_t now);
+
+    void PutSession(const SessionRecord& session);
+    // Fills in the session's expiry and the hardware ID it was issued to.
+    bool FindSession(const Digest& token, const Digest& username, std::time_t now,
+                     std::time_t& expiresAt, Digest& hwid);
+    void EraseSession(const Digest& token, const Digest& username);
+    size_t PurgeExpiredSessions(std::time_t now);
+
+    size_t LicenseCount();
+    size_t SessionCount();
+
+    // Writes snapshot.bin and drops the logs it covers. Call from one thread.
+    bool Snapshot(std::string& error);
+    // Flushes the log to stable storage. Call from one thread.
+    void Sync();
+};
+
+#endif
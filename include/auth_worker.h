@@ -0,0 +1,112 @@
+#ifndef AUTH_WORKER_H
+#define AUTH_WORKER_H
+
+#include "auth_handler.h"
+#include "cancellation.h"
+#include "heartbeat_scheduler.h"
+#include "mpsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class AuthTaskType {
+    Login,
+    CheckSession,
+    Logout,
+    Resume,
+    Preconnect,
+    SessionLost  // completion only: a heartbeat found the session gone
+};
+
+struct AuthTask {
+    AuthTaskType type = AuthTaskType::CheckSession;
+    uint64_t id = 0;
+    std::string username;
+    std::string key;
+    // Upper bound for the whole task, on top of HTTP_TIMEOUT per request.
+    // Zero leaves only HTTP_TIMEOUT.
+    std::chrono::milliseconds timeout{0};
+};
+
+struct AuthCompletion {
+    AuthTaskType type = AuthTaskType::CheckSession;
+    uint64_t id = 0;
+    bool success = false;
+    bool cancelled = false;
+    std::string message;
+    std::string username;
+};
+
+// Long-lived thread that owns the AuthHandler and runs login, session check,
+// logout and resume tasks one at a time. Callers never block: Post copies the
+// task into a lock-free queue, and results come back through a second queue
+// that the owner drains with PollCompletion, e.g. once per frame. After each
+// result `onCompletion` is invoked from the producing thread so the owner can
+// wake up; it must not block.
+//
+// Successful logins and resumes start a background heartbeat; a session it
+// loses is reported as a SessionLost completion.
+//
+// Every request the worker makes carries its shutdown token, so Shutdown()
+// returns as soon as the request in progress is aborted instead of waiting out
+// its timeout.
+class AuthWorker {
+private:
+    AuthHandler handler;
+    MpscQueue<AuthCompletion> completions;
+    MpscQueue<AuthTask> tasks;
+    std::function<void()> onCompletion;
+    HeartbeatScheduler heartbeat;
+    HeartbeatScheduler::SessionId heartbeatId;
+    std::atomic<uint64_t> nextTaskId;
+    CancellationToken shutdownToken;
+
+    // Only used to park the worker while the task queue is empty.
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<bool> sleeping;
+    std::atomic<bool> stopping;
+    std::thread workerThread;
+
+    void Run();
+    AuthCompletion Execute(const AuthTask& task);
+    void StartHeartbeat();
+    void StopHeartbeat();
+    void Complete(AuthCompletion completion);
+
+public:
+    explicit AuthWorker(std::function<void()> onCompletion = nullptr);
+    AuthWorker(const std::string& apiBaseUrl, std::function<void()> onCompletion);
+    ~AuthWorker();
+
+    AuthWorker(const AuthWorker&) = delete;
+    AuthWorker& operator=(const AuthWorker&) = delete;
+
+    // Queues a task and returns its id, which the matching completion carries.
+    uint64_t Post(AuthTask task);
+    uint64_t Login(const std::string& username, const std::string& key);
+    uint64_t CheckSession();
+    uint64_t Logout();
+    uint64_t Resume();
+    // Warms the connection to the API host ahead of a login. Bounded by
+    // PRECONNECT_TIMEOUT_MS so a slow handshake cannot hold up tasks queued
+    // behind it for long; a login queued meanwhile reuses the connection.
+    uint64_t Preconnect();
+
+    // Aborts the task in progress, drops any still queued and stops the thread
+    // and heartbeats. The onCompletion callback is not invoked afterwards.
+    // Also run by the destructor.
+    void Shutdown();
+
+    // Owner thread only. Returns false when no result is waiting.
+    bool PollCompletion(AuthCompletion& completion);
+
+    HeartbeatStats GetHeartbeatStats();
+};
+
+#endif
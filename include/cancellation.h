@@ -0,0 +1,129 @@
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Cooperative cancellation. Copies of a token share one state, so the code
+// that starts an operation keeps a copy and cancels it while whoever is doing
+// the work polls IsCancelled() or registers a callback. A default-constructed
+// token can never be cancelled and costs nothing to pass around.
+class CancellationToken {
+private:
+    struct State {
+        std::atomic<bool> cancelled{false};
+        std::mutex mutex;
+        std::unordered_map<uint64_t, std::function<void()>> callbacks;
+        uint64_t nextCallbackId = 1;
+    };
+
+    std::shared_ptr<State> state;
+
+public:
+    CancellationToken() = default;
+
+    static CancellationToken Create() {
+        CancellationToken token;
+        token.state = std::make_shared<State>();
+        return token;
+    }
+
+    bool CanBeCancelled() const { return state != nullptr; }
+
+    bool IsCancelled() const {
+        return state && state->cancelled.load(std::memory_order_acquire);
+    }
+
+    // Runs the registered callbacks on the calling thread. Later calls do
+    // nothing.
+    void Cancel() {
+        if (!state) {
+            return;
+        }
+
+        std::unordered_map<uint64_t, std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->cancelled.exchange(true, std::memory_order_acq_rel)) {
+                return;
+            }
+            callbacks.swap(state->callbacks);
+        }
+        for (auto& entry : callbacks) {
+            entry.second();
+        }
+    }
+
+    // Registers a callback for Cancel(). If the token is already cancelled the
+    // callback runs immediately and 0 is returned. Callbacks must be short and
+    // must not call back into the token.
+    uint64_t OnCancel(std::function<void()> callback) {
+        if (!state) {
+            return 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (!state->cancelled.load(std::memory_order_relaxed)) {
+                uint64_t id = state->nextCallbackId++;
+                state->callbacks.emplace(id, std::move(callback));
+                return id;
+            }
+        }
+        callback();
+        return 0;
+    }
+
+    // A callback that Cancel() already picked up may still be running when
+    // this returns.
+    void RemoveCallback(uint64_t id) {
+        if (!state || id == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->callbacks.erase(id);
+    }
+};
+
+// Limits carried from the caller of an operation down to every HTTP transfer
+// it makes: a cancellation token and an absolute deadline. The default
+// context never cancels and falls back to the transfer's own timeout.
+struct OperationContext {
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken cancellation;
+    Clock::time_point deadline = Clock::time_point::max();
+
+    OperationContext() = default;
+    explicit OperationContext(CancellationToken token) : cancellation(std::move(token)) {}
+
+    static OperationContext WithTimeout(std::chrono::milliseconds timeout,
+                                        CancellationToken token = CancellationToken()) {
+        OperationContext context(std::move(token));
+        context.deadline = Clock::now() + timeout;
+        return context;
+    }
+
+    bool HasDeadline() const { return deadline != Clock::time_point::max(); }
+
+    // Milliseconds a transfer may still take, capped at `limitMs`. Never
+    // returns 0, which curl would read as "no timeout".
+    long TimeoutMs(long limitMs) const {
+        if (!HasDeadline()) {
+            return limitMs;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (remaining < 1) {
+            return 1;
+        }
+        return remaining < limitMs ? static_cast<long>(remaining) : limitMs;
+    }
+};
+
+#endif
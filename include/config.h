@@ -2,17 +2,138 @@
 #define CONFIG_H
 
 #include <string>
+#include <cstddef>
+#include <vector>
 
 const std::string APP_VERSION = "1.0.0";
 const std::string APP_NAME = "Login Sys By @Tgshaitaan";
 
 const std::string API_BASE_URL = "https://your-website.com/api";
 
-const std::string API_VALIDATE_ENDPOINT = API_BASE_URL + "/validate";
-const std::string API_CHECK_SESSION_ENDPOINT = API_BASE_URL + "/check-session";
-const std::string API_LOGOUT_ENDPOINT = API_BASE_URL + "/logout";
+const std::string API_VALIDATE_PATH = "/validate";
+const std::string API_CHECK_SESSION_PATH = "/check-session";
+const std::string API_LOGOUT_PATH = "/logout";
+const std::string API_CHECK_SESSION_BATCH_PATH = "/check-session/batch";
+
+const std::string API_VALIDATE_ENDPOINT = API_BASE_URL + API_VALIDATE_PATH;
+const std::string API_CHECK_SESSION_ENDPOINT = API_BASE_URL + API_CHECK_SESSION_PATH;
+const std::string API_LOGOUT_ENDPOINT = API_BASE_URL + API_LOGOUT_PATH;
+const std::string API_CHECK_SESSION_BATCH_ENDPOINT = API_BASE_URL + API_CHECK_SESSION_BATCH_PATH;
+
+// Other base URLs serving the same API as API_BASE_URL (see MirrorSet).
+// Latency and error rate are EWMAs that move ALPHA of the way to each new
+// sample. A request that could not reach its mirror is retried on the next
+// best one. Mirrors idle for PROBE_INTERVAL_SECONDS get a HEAD request so
+// their numbers stay current.
+const std::vector<std::string> API_MIRROR_BASE_URLS = {};
+const double MIRROR_EWMA_ALPHA = 0.2;
+const double MIRROR_ERROR_PENALTY = 4.0;
+const unsigned MIRROR_MAX_FAILURES = 3;
+const long MIRROR_RETRY_SECONDS = 30;
+const long MIRROR_PROBE_INTERVAL_SECONDS = 30;
 
 const long HTTP_TIMEOUT = 30;
+// Defaults of HTTPRequestOptions. Connection setup gets CONNECT_TIMEOUT_MS of
+// HTTP_TIMEOUT, so a dead host fails in seconds. A transfer that moves fewer
+// than LOW_SPEED_LIMIT bytes/s for LOW_SPEED_TIME seconds, including a server
+// that never starts answering, is aborted as stalled.
+const long HTTP_CONNECT_TIMEOUT_MS = 2000;
+const long HTTP_LOW_SPEED_LIMIT = 1;
+const long HTTP_LOW_SPEED_TIME = 10;
+const long HTTP_DNS_CACHE_TTL = 60;
+const std::string HTTP_USER_AGENT = "BR-MODS-Client/1.0";
+// Total deadlines of the auth endpoints, tighter than HTTP_TIMEOUT since a
+// user is waiting on each of them.
+const long API_VALIDATE_TIMEOUT_MS = 10000;
+const long API_CHECK_SESSION_TIMEOUT_MS = 5000;
+const long API_LOGOUT_TIMEOUT_MS = 5000;
+// Body encoding the client asks for: "json", "cbor" or "msgpack". Requests
+// switch from JSON only after the server has answered in this format.
+const std::string HTTP_WIRE_FORMAT = "cbor";
+// "1.1", "2" (ALPN on https, h2c upgrade on http, falls back to 1.1) or
+// "h2c" (HTTP/2 over plain http without the upgrade round trip).
+const std::string HTTP_VERSION = "1.1";
+const bool HTTP_ACCEPT_COMPRESSED = true;
+// Response buffers are reserved up front from Content-Length up to this size;
+// larger or unsized bodies grow as they arrive.
+const long long HTTP_MAX_PRESIZE_BYTES = 1 << 20;
+// Deadline for the fire-and-forget logout sent when a handler that does not
+// persist its session is destroyed.
+const long LOGOUT_ON_EXIT_TIMEOUT_MS = 2000;
+// The GUI warms a connection to the API host when the login panel appears and
+// again on username focus if the last warm-up is older than the refresh
+// interval, which should stay below the server's keep-alive idle timeout.
+const bool PRECONNECT_ENABLED = true;
+const long PRECONNECT_TIMEOUT_MS = 5000;
+const long PRECONNECT_REFRESH_SECONDS = 20;
+
+// Hedged session checks (AuthHandler::SetHedging). A second copy goes out
+// once a check has taken longer than the DELAY_PERCENTILE latency of recent
+// checks, at least MIN_DELAY_MS. Hedges are limited to BUDGET_PERCENT of
+// calls, with up to BUDGET_BURST saved up for bursts of slow replies.
+const bool HEDGE_CHECK_SESSION = false;
+const double HEDGE_DELAY_PERCENTILE = 0.95;
+const long HEDGE_MIN_DELAY_MS = 5;
+const unsigned long HEDGE_MIN_SAMPLES = 20;
+const double HEDGE_BUDGET_PERCENT = 5.0;
+const double HEDGE_BUDGET_BURST = 10.0;
+
+// Distinct URL paths HTTPMetrics keeps separate histograms for; later paths
+// are counted under "other".
+const std::size_t HTTP_METRICS_MAX_ENDPOINTS = 32;
+
+const std::size_t HTTP_POOL_MAX_IDLE_HANDLES = 8;
+// Live connections kept in the shared cache. libcurl's default scales with the
+// handles attached at the moment a transfer finishes, which evicts keep-alive
+// connections under concurrency.
+const long HTTP_POOL_MAX_CONNECTIONS = 64;
+const long HTTP_KEEPALIVE_IDLE = 60;
+const long HTTP_KEEPALIVE_INTERVAL = 30;
+
+const bool SESSION_RESUME_ENABLED = true;
+const std::string SESSION_CACHE_FILE_NAME = ".loginsys_session";
+const int SESSION_CACHE_KDF_ITERATIONS = 10000;
+const long SESSION_RESUME_OFFLINE_GRACE = 300;
+const long SESSION_RESUME_MIN_REMAINING = 60;
+
+// Public half of the server's --signing-key, as printed by
+// `openssl pkey -in signing.pem -pubout`. When set, CheckSession confirms a
+// signed session locally and only asks the server once the last server
+// confirmation is older than LOCAL_MAX_AGE seconds (which bounds how long a
+// revoked session keeps working) or fewer than LOCAL_MIN_REMAINING seconds
+// of the session are left. Empty disables local checks.
+const std::string SESSION_SIGNING_PUBLIC_KEY = "";
+const long SESSION_LOCAL_CHECK_MAX_AGE = 900;
+const long SESSION_LOCAL_CHECK_MIN_REMAINING = 60;
+// How long a session check the server confirmed is reused for further
+// CheckSession calls.
+const long SESSION_CHECK_CACHE_MS = 1000;
+
+// Background session heartbeats: the next check lands at a fraction of the
+// remaining session lifetime, clamped to [MIN, MAX] and spread by +/- JITTER.
+// Failed checks back off exponentially from BACKOFF_BASE up to BACKOFF_MAX.
+const long HEARTBEAT_MIN_INTERVAL = 30;
+const long HEARTBEAT_MAX_INTERVAL = 300;
+const double HEARTBEAT_EXPIRY_FRACTION = 0.5;
+const double HEARTBEAT_JITTER = 0.2;
+const long HEARTBEAT_BACKOFF_BASE = 5;
+const long HEARTBEAT_BACKOFF_MAX = 300;
+
+const std::size_t SESSION_BATCH_SIZE = 256;
+const std::size_t SESSION_BATCH_IN_FLIGHT = 4;
+const std::size_t SESSION_PIPELINE_DEPTH = 64;
+
+const std::size_t CLI_DEFAULT_IN_FLIGHT = 32;
+
+const std::string BENCH_DEFAULT_BASE_URL = "http://127.0.0.1:5000/api";
+
+// Empty uses ImGui's built-in font.
+const std::string UI_FONT_FILE = "";
+const float UI_FONT_BASE_SIZE = 13.0f;
+const std::string FONT_ATLAS_CACHE_FILE_NAME = ".loginsys_fonts";
+
+const std::size_t INTEGRITY_READ_CHUNK_SIZE = 1 << 20;
+const long INTEGRITY_RECHECK_INTERVAL = 0;
 
 #ifdef ENABLE_INTEGRITY_CHECK
 const std::string EXPECTED_BINARY_CHECKSUM = "REPLACE_WITH_YOUR_BINARY_SHA256_HASH";
@@ -0,0 +1,57 @@
+#ifndef CURL_POOL_H
+#define CURL_POOL_H
+
+#include "http_client.h"
+#include <curl/curl.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Process-wide owner of libcurl state. Performs curl_global_init exactly once,
+// keeps a small pool of idle easy handles and a CURLSH that shares the DNS
+// cache, TLS session cache and connection cache between every handle, so
+// consecutive requests to the same host reuse one warm connection.
+class CurlPool {
+private:
+    CURLSH* share;
+    std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+    std::mutex poolMutex;
+    std::vector<CURL*> idleHandles;
+
+    std::atomic<unsigned long long> requests{0};
+    std::atomic<unsigned long long> connectionsReused{0};
+    std::atomic<unsigned long long> connectionsOpened{0};
+    std::atomic<unsigned long long> http2Requests{0};
+    std::atomic<unsigned long long> preconnects{0};
+    std::atomic<unsigned long long> preconnectSavedUs{0};
+    // Setup time of the last preconnect, claimed by the next transfer if it
+    // reuses a connection; 0 once claimed.
+    std::atomic<long long> warmConnectUs{0};
+
+    CurlPool();
+    ~CurlPool();
+    CurlPool(const CurlPool&) = delete;
+    CurlPool& operator=(const CurlPool&) = delete;
+
+    static void LockCallback(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp);
+    static void UnlockCallback(CURL* handle, curl_lock_data data, void* userp);
+
+public:
+    static CurlPool& Instance();
+
+    // Returns a handle attached to the shared cache, or nullptr on failure.
+    CURL* Acquire();
+    // Resets the handle and keeps it for reuse; open connections stay cached.
+    void Release(CURL* curl);
+    // Attaches a handle created outside the pool (e.g. for curl_multi) to the share.
+    void Attach(CURL* curl);
+    // Updates reuse counters from a finished transfer.
+    void RecordTransfer(CURL* curl);
+    // Remembers what the connection set up by a preconnect cost, so the next
+    // transfer that reuses it can count the time as saved.
+    void RecordPreconnect(CURL* curl);
+
+    HTTPConnectionStats GetStats() const;
+};
+
+#endif
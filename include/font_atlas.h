@@ -0,0 +1,46 @@
+#ifndef FONT_ATLAS_H
+#define FONT_ATLAS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ImFont;
+struct ImFontAtlas;
+
+struct FontAtlasStats {
+    bool cacheHit;
+    double milliseconds;
+};
+
+// Bakes one font at several pixel sizes into the ImGui atlas so text can be
+// drawn with PushFont instead of bitmap-scaled with SetWindowFontScale.
+// Rasterizing glyphs is most of the cost, so the finished atlas (glyph
+// metrics plus the alpha texture) is cached on disk. The cache is keyed by the
+// font contents, the sizes and the ImGui version and is rebuilt whenever any
+// of them change.
+//
+// Restoring relies on the pre-1.92 static atlas layout; newer ImGui versions
+// rasterize glyphs lazily and always build normally.
+class FontAtlasCache {
+private:
+    std::string path;
+
+    static uint64_t CacheKey(const std::string& fontData, const std::vector<float>& sizes);
+    bool Restore(ImFontAtlas* atlas, uint64_t key, const std::vector<ImFont*>& fonts) const;
+    bool Save(ImFontAtlas* atlas, uint64_t key, const std::vector<ImFont*>& fonts) const;
+
+public:
+    FontAtlasCache();
+    explicit FontAtlasCache(const std::string& filePath);
+
+    // Adds `fontFile` (the built-in ImGui font when empty or unreadable) at
+    // each size and leaves the atlas ready for the renderer to upload.
+    // Returns the fonts in the order of `sizes`.
+    std::vector<ImFont*> Load(ImFontAtlas* atlas, const std::string& fontFile,
+                              const std::vector<float>& sizes, FontAtlasStats& stats);
+
+    static std::string DefaultPath();
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef HEARTBEAT_SCHEDULER_H
+#define HEARTBEAT_SCHEDULER_H
+
+#include "cancellation.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class AuthHandler;
+
+struct HeartbeatConfig {
+    long minInterval;
+    long maxInterval;
+    double expiryFraction;
+    double jitter;
+    long backoffBase;
+    long backoffMax;
+
+    HeartbeatConfig();
+};
+
+struct HeartbeatStats {
+    uint64_t sent;
+    uint64_t succeeded;
+    uint64_t failures;      // transport errors, retried with backoff
+    uint64_t sessionsLost;  // server reported the session invalid
+    size_t sessions;
+    std::time_t nextScheduledAt;  // wall-clock time of the next check, 0 if none
+};
+
+// Keeps sessions alive-checked in the background with one timer thread for
+// any number of sessions. Due checks sit in a min-heap; the thread sleeps until
+// the earliest one and fires it through CheckSessionAsync, so the check itself
+// runs on the shared HTTP event loop. Each check is scheduled from the
+// session's expiresAt with random jitter, which keeps a fleet of clients from
+// hitting the backend in lockstep. Transport failures back off exponentially.
+// A session the server rejects is dropped and its onLost callback runs on the
+// event loop thread. Stopping the scheduler cancels checks still in flight.
+class HeartbeatScheduler {
+public:
+    using SessionId = uint64_t;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Session {
+        AuthHandler* handler;
+        std::function<void()> onLost;
+        unsigned failures;
+        uint64_t generation;
+        bool inFlight;
+    };
+
+    struct Due {
+        Clock::time_point when;
+        SessionId id;
+        uint64_t generation;
+
+        bool operator>(const Due& other) const { return when > other.when; }
+    };
+
+    HeartbeatConfig config;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::unordered_map<SessionId, Session> sessions;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> schedule;
+    std::mt19937_64 random;
+    SessionId nextId;
+    size_t inFlight;
+    bool stopping;
+    HeartbeatStats stats;
+    CancellationToken cancellation;
+    std::thread timerThread;
+
+    void Run();
+    void OnResult(SessionId id, bool valid);
+    // Caller holds the mutex.
+    void ScheduleLocked(SessionId id, Session& session);
+    double NextDelayLocked(const Session& session);
+
+public:
+    explicit HeartbeatScheduler(const HeartbeatConfig& heartbeatConfig = HeartbeatConfig());
+    ~HeartbeatScheduler();
+
+    HeartbeatScheduler(const HeartbeatScheduler&) = delete;
+    HeartbeatScheduler& operator=(const HeartbeatScheduler&) = delete;
+
+    // Starts heartbeats for an authenticated handler, which must outlive its
+    // registration. The first check is scheduled like any other, not sent
+    // immediately.
+    SessionId Add(AuthHandler& handler, std::function<void()> onLost = nullptr);
+    // Stops heartbeats for a session, waiting for a check already in flight.
+    // Must not be called from an onLost callback for another session.
+    void Remove(SessionId id);
+    // Stops the timer thread and aborts checks in flight without reporting
+    // any session as lost. Also run by the destructor.
+    void Stop();
+
+    HeartbeatStats GetStats();
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef HEX_H
+#define HEX_H
+
+#include <cstddef>
+#include <string>
+
+// Lowercase hex encoding for digests and keys. Each input byte is one lookup
+// in a 512-byte table of digit pairs built at compile time, so encoding a
+// SHA-256 digest is 32 two-byte copies into a buffer sized up front.
+
+namespace hex_detail {
+
+struct PairTable {
+    char pairs[512];
+
+    constexpr PairTable() : pairs() {
+        const char digits[] = "0123456789abcdef";
+        for (int i = 0; i < 256; i++) {
+            pairs[2 * i] = digits[i >> 4];
+            pairs[2 * i + 1] = digits[i & 0x0f];
+        }
+    }
+};
+
+inline constexpr PairTable PAIR_TABLE{};
+
+}
+
+// Writes 2 * length characters to `out`, without a terminator.
+inline void HexEncode(const unsigned char* data, size_t length, char* out) {
+    for (size_t i = 0; i < length; i++) {
+        const char* pair = &hex_detail::PAIR_TABLE.pairs[2 * data[i]];
+        out[2 * i] = pair[0];
+        out[2 * i + 1] = pair[1];
+    }
+}
+
+inline std::string HexEncode(const unsigned char* data, size_t length) {
+    std::string hex(length * 2, '\0');
+    HexEncode(data, length, &hex[0]);
+    return hex;
+}
+
+// Value of one hex digit in either case, -1 for anything else.
+inline int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes exactly `length` bytes; false if `hex` has another length or a
+// non-hex character.
+inline bool HexDecode(const std::string& hex, unsigned char* out, size_t length) {
+    if (hex.size() != length * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        int high = HexValue(hex[2 * i]);
+        int low = HexValue(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[i] = static_cast<unsigned char>(high << 4 | low);
+    }
+    return true;
+}
+
+#endif
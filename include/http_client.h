@@ -1,31 +1,231 @@
 #ifndef HTTP_CLIENT_H
 #define HTTP_CLIENT_H
 
+#include "cancellation.h"
+#include "config.h"
+#include "mirror_set.h"
+#include "wire_format.h"
+#include <atomic>
 #include <string>
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+// HTTP version the client asks for. Http2 negotiates through ALPN on https
+// and an "Upgrade: h2c" on plain http, falling back to HTTP/1.1 either way.
+// Http2PriorKnowledge starts plain-http connections as h2c directly and only
+// works against servers known to speak it.
+enum class HTTPVersion {
+    Http1,
+    Http2,
+    Http2PriorKnowledge
+};
+
+// Accepts "1.1", "2" and "h2c".
+bool HTTPVersionFromName(const std::string& name, HTTPVersion& version);
+const char* HTTPVersionName(HTTPVersion version);
+
+// Transport limits for one request. The defaults come from config.h, so
+// HTTP_TIMEOUT bounds every request unless something tighter is set.
+struct HTTPRequestOptions {
+    // DNS, TCP and TLS together; an unreachable host fails after this rather
+    // than after the whole timeout.
+    long connectTimeoutMs = HTTP_CONNECT_TIMEOUT_MS;
+    // The whole request, connection setup included.
+    long timeoutMs = HTTP_TIMEOUT * 1000;
+    // Abort once the transfer has moved fewer than lowSpeedLimit bytes per
+    // second for lowSpeedTimeSec seconds. 0 turns the check off.
+    long lowSpeedLimit = HTTP_LOW_SPEED_LIMIT;
+    long lowSpeedTimeSec = HTTP_LOW_SPEED_TIME;
+    // How long resolved addresses stay in the shared DNS cache.
+    long dnsCacheTtlSec = HTTP_DNS_CACHE_TTL;
+};
+
 struct HTTPResponse {
     bool success;
+    bool cancelled;
     int statusCode;
+    // Protocol the response arrived over: 10, 11, 20 or 30 for HTTP/1.0, 1.1,
+    // 2 and 3; 0 if no response was received.
+    int httpVersion;
     std::string body;
+    // Encoding of `body` per the response's Content-Type; JSON when absent.
+    WireFormat format;
     std::string error;
+    // Failed before any of the request was sent (DNS, connect or TLS), so
+    // it is safe to send again elsewhere.
+    bool connectFailed;
 };
 
+struct HTTPConnectionStats {
+    unsigned long long requests;
+    unsigned long long connectionsReused;
+    unsigned long long connectionsOpened;
+    unsigned long long http2Requests;
+    // Preconnect() calls, and the connection setup time they took off the
+    // requests that went on to reuse the warm connection.
+    unsigned long long preconnects;
+    double preconnectSavedMs;
+};
+
+// Counters for PostHedged calls made through one client.
+struct HedgeStats {
+    unsigned long long calls;
+    unsigned long long hedgesIssued;
+    // Replies that came from the second copy before the first.
+    unsigned long long hedgesWon;
+    // Hedges that were due but skipped because the budget was spent.
+    unsigned long long hedgesDenied;
+    // Latency seen by callers, hedge included.
+    double p50Ms;
+    double p99Ms;
+};
+
+using HTTPCallback = std::function<void(const HTTPResponse&)>;
+
+struct PendingTransfer;
+
+// Request bodies start out as JSON. Each request advertises the preferred
+// binary format in Accept; once the server answers in it, later bodies are
+// sent that way too. A 415 reply to a binary body switches the client back to
+// JSON for good and resends that request once, so servers that only accept
+// JSON bodies keep working.
 class HTTPClient {
 private:
+    // Shared with completion callbacks, which can outlive the client.
+    struct WireState {
+        WireFormat preferred;
+        std::atomic<WireFormat> request;
+        // Set by a 415; the client then stays on JSON even if responses keep
+        // arriving in the binary format.
+        std::atomic<bool> binaryRejected;
+    };
+
+    struct HedgeState;
+    struct HedgeRace;
+
+    std::shared_ptr<WireState> wire;
+    std::shared_ptr<HedgeState> hedge;
+    std::shared_ptr<MirrorSet> mirrors;
+    HTTPVersion httpVersion;
+    bool acceptCompressed;
+    std::string userAgent;
+    HTTPRequestOptions defaultOptions;
+    // Keyed by URL path.
+    std::unordered_map<std::string, HTTPRequestOptions> endpointOptions;
+
     static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
-    bool VerifySSL(const std::string& url);
+    static bool VerifySSL(const std::string& url);
+    static bool Prepare(PendingTransfer& transfer, bool isPost);
+    static HTTPResponse BuildResponse(PendingTransfer& transfer, int result);
+    static std::unique_ptr<PendingTransfer> CopyTransfer(const PendingTransfer& sent);
+    static std::unique_ptr<PendingTransfer> Negotiate(WireState& state, PendingTransfer& sent,
+                                                      const HTTPResponse& response);
+    static std::unique_ptr<PendingTransfer> Failover(PendingTransfer& sent, const HTTPResponse& response);
+    // The next transfer to send for `sent`, if any: a failover or a JSON
+    // resend.
+    static std::unique_ptr<PendingTransfer> FollowUp(WireState& state, PendingTransfer& sent,
+                                                     const HTTPResponse& response);
+    void ProbeMirror(int index, const PendingTransfer& transfer) const;
+    HTTPResponse Perform(std::unique_ptr<PendingTransfer> transfer, bool isPost);
+    static void Dispatch(std::shared_ptr<WireState> state, std::unique_ptr<PendingTransfer> transfer,
+                         bool isPost, HTTPCallback callback);
+    std::unique_ptr<PendingTransfer> NewTransfer(const std::string& url, const OperationContext& context) const;
+    std::unique_ptr<PendingTransfer> NewTransfer(const std::string& url, const HTTPRequestOptions& options,
+                                                 const OperationContext& context) const;
+    static void FinishHedged(const std::shared_ptr<HedgeState>& state, const std::shared_ptr<HedgeRace>& race,
+                             const HTTPResponse& response, bool fromHedge);
 
 public:
     HTTPClient();
     ~HTTPClient();
     
-    HTTPResponse Get(const std::string& url);
-    HTTPResponse Post(const std::string& url, const json& data);
+    // Every request honours the context's deadline on top of its
+    // HTTPRequestOptions (see SetEndpointOptions) and fails with `cancelled`
+    // set as soon as its token is cancelled. Blocking calls with a
+    // cancellable token run on the event loop so that happens immediately
+    // rather than at curl's next progress callback. With HTTP/2
+    // they run there too, so concurrent callers share one multiplexed
+    // connection per host instead of each holding its own.
+    HTTPResponse Get(const std::string& url, const OperationContext& context = OperationContext());
+    HTTPResponse Post(const std::string& url, const RequestBody& body,
+                      const OperationContext& context = OperationContext());
+    // Same, with limits for this request only instead of the endpoint's.
+    HTTPResponse Get(const std::string& url, const HTTPRequestOptions& options,
+                     const OperationContext& context = OperationContext());
+    HTTPResponse Post(const std::string& url, const RequestBody& body, const HTTPRequestOptions& options,
+                      const OperationContext& context = OperationContext());
+
+    // Non-blocking variants driven by the shared curl_multi event loop.
+    // Callbacks run on the loop thread; keep them short. `body` is encoded
+    // before the call returns.
+    void GetAsync(const std::string& url, HTTPCallback callback,
+                  const OperationContext& context = OperationContext());
+    void PostAsync(const std::string& url, const RequestBody& body, HTTPCallback callback,
+                   const OperationContext& context = OperationContext());
+    void GetAsync(const std::string& url, const HTTPRequestOptions& options, HTTPCallback callback,
+                  const OperationContext& context = OperationContext());
+    void PostAsync(const std::string& url, const RequestBody& body, const HTTPRequestOptions& options,
+                   HTTPCallback callback, const OperationContext& context = OperationContext());
+    std::future<HTTPResponse> GetAsync(const std::string& url);
+    std::future<HTTPResponse> PostAsync(const std::string& url, const RequestBody& body);
+
+    // Resolves the host of `url` and completes the TCP and TLS handshakes
+    // with a HEAD request, leaving the connection in the shared cache for the
+    // next request to the same host. Any HTTP status counts as success.
+    bool Preconnect(const std::string& url, const OperationContext& context = OperationContext());
+
+    // For idempotent requests only. If no reply has arrived once the
+    // endpoint's HEDGE_DELAY_PERCENTILE latency has passed, a second copy is
+    // sent; the first reply wins and the other copy is cancelled. Hedges are
+    // capped at HEDGE_BUDGET_PERCENT of calls. Until HEDGE_MIN_SAMPLES
+    // requests to the endpoint have been timed this behaves like Post.
+    HTTPResponse PostHedged(const std::string& url, const RequestBody& body,
+                            const OperationContext& context = OperationContext());
+    void PostHedgedAsync(const std::string& url, const RequestBody& body, HTTPCallback callback,
+                         const OperationContext& context = OperationContext());
+    HedgeStats GetHedgeStats() const;
+
+    // Defaults to HTTP_WIRE_FORMAT. Passing WireFormat::Json turns
+    // negotiation off. Call before issuing requests.
+    void SetWireFormat(WireFormat preferred);
+    // Encoding used for request bodies right now.
+    WireFormat GetRequestFormat() const;
+
+    // Default HTTP_VERSION. Applies to requests issued afterwards.
+    void SetHttpVersion(HTTPVersion version);
+    // Advertises every encoding libcurl can decode in Accept-Encoding and
+    // decompresses responses transparently. Default HTTP_ACCEPT_COMPRESSED.
+    void SetAcceptCompressed(bool enabled);
+
+    // Limits for requests to endpoints without their own. Call before
+    // issuing requests, like SetEndpointOptions.
+    void SetDefaultOptions(const HTTPRequestOptions& options);
+    // Limits for every request whose URL has the same path as `url`, on any
+    // host.
+    void SetEndpointOptions(const std::string& url, const HTTPRequestOptions& options);
+    HTTPRequestOptions GetOptions(const std::string& url) const;
+    // Total timeout of the default options, in seconds.
     void SetTimeout(long timeout);
-    void SetUserAgent(const std::string& userAgent);
+    // Default HTTP_USER_AGENT.
+    void SetUserAgent(const std::string& agent);
+
+    // Routes every request whose URL starts with one of `baseUrls` to the
+    // mirror MirrorSet picks, and retries a request that could not connect
+    // on the next one. Fewer than two URLs turns this off. Call before
+    // issuing requests.
+    void SetMirrors(const std::vector<std::string>& baseUrls);
+    // Empty without mirrors.
+    std::vector<MirrorStats> GetMirrorStats() const;
+
+    // Requests served by the shared handle pool and how many of them reused
+    // an already open connection instead of paying for DNS, TCP and TLS.
+    static HTTPConnectionStats GetConnectionStats();
 };
 
 #endif
@@ -0,0 +1,97 @@
+#ifndef HTTP_EVENT_LOOP_H
+#define HTTP_EVENT_LOOP_H
+
+#include "cancellation.h"
+#include "http_client.h"
+#include "mirror_set.h"
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A request prepared by HTTPClient. Owns every buffer the easy handle points
+// at, so it must stay at a stable address until the transfer completes. The
+// destructor frees the header list and returns the handle to CurlPool.
+struct PendingTransfer {
+    CURL* curl = nullptr;
+    std::string url;
+    std::string postData;
+    WireFormat bodyFormat = WireFormat::Json;
+    WireFormat acceptFormat = WireFormat::Json;
+    HTTPVersion httpVersion = HTTPVersion::Http1;
+    bool acceptCompressed = false;
+    HTTPRequestOptions options;
+    std::string userAgent;
+    // Sent by HTTPClient::Preconnect: HEAD only and kept out of the request
+    // counters.
+    bool preconnect = false;
+    // A preconnect sent only to refresh a mirror's stats.
+    bool mirrorProbe = false;
+    // Set when `url` was routed through a MirrorSet: the mirror it went to,
+    // the part of the URL after the base, and every mirror tried so far.
+    std::shared_ptr<MirrorSet> mirrors;
+    int mirror = -1;
+    std::string mirrorPath;
+    uint32_t mirrorsTried = 0;
+    std::string readBuffer;
+    // Shared by every transfer with the same formats and never freed; see
+    // HTTPClient::Prepare.
+    struct curl_slist* headers = nullptr;
+    OperationContext context;
+    uint64_t cancelCallback = 0;
+    std::function<void(PendingTransfer& transfer, CURLcode result)> onDone;
+
+    PendingTransfer() = default;
+    ~PendingTransfer();
+    PendingTransfer(const PendingTransfer&) = delete;
+    PendingTransfer& operator=(const PendingTransfer&) = delete;
+};
+
+// Single background thread driving a curl_multi handle. Any number of
+// transfers can be in flight at once without a thread per request.
+// Completion callbacks run on the loop thread and must not block.
+class HTTPEventLoop {
+private:
+    CURLM* multi;
+    std::thread loopThread;
+    std::atomic<bool> stopping{false};
+    std::mutex submitMutex;
+    std::vector<std::unique_ptr<PendingTransfer>> submitted;
+    std::unordered_map<CURL*, std::unique_ptr<PendingTransfer>> active;
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> timers;
+
+    HTTPEventLoop();
+    ~HTTPEventLoop();
+    HTTPEventLoop(const HTTPEventLoop&) = delete;
+    HTTPEventLoop& operator=(const HTTPEventLoop&) = delete;
+
+    void Run();
+    void AddSubmitted();
+    void ProcessCompleted();
+    void AbortCancelled();
+    // Runs due timers; returns milliseconds until the next one, capped at
+    // `limitMs`.
+    int RunTimers(int limitMs);
+    void Complete(PendingTransfer* transfer, CURLcode result);
+
+public:
+    static HTTPEventLoop& Instance();
+
+    // A transfer whose token is cancelled is removed on the next loop pass and
+    // completes with CURLE_ABORTED_BY_CALLBACK; cancelling wakes the loop.
+    void Submit(std::unique_ptr<PendingTransfer> transfer);
+    // Runs `task` on the loop thread once `delay` has passed. Tasks still
+    // pending at shutdown are dropped.
+    void RunAfter(std::chrono::milliseconds delay, std::function<void()> task);
+    size_t InFlight();
+    bool IsLoopThread() const;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef HTTP_METRICS_H
+#define HTTP_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Where a request's time went, from libcurl's cumulative timers. DNS, Connect
+// and TLS are only recorded for requests that opened a new connection; TLS
+// only on https. Server runs from the connection being ready until the first
+// response byte, so it covers sending the request and the server's think
+// time; Transfer is the rest of the response.
+enum class HTTPPhase {
+    DNS,
+    Connect,
+    TLS,
+    Server,
+    Transfer,
+    Total,
+    Count
+};
+
+const char* HTTPPhaseName(HTTPPhase phase);
+
+// Upper bounds of the latency buckets in microseconds; a final +Inf bucket
+// catches the rest. Fixed so histograms export to Prometheus unchanged.
+const uint64_t HTTP_LATENCY_BOUNDS_US[] = {
+    100, 250, 500,
+    1000, 2500, 5000,
+    10000, 25000, 50000,
+    100000, 250000, 500000,
+    1000000, 2500000, 5000000,
+    10000000, 30000000
+};
+const size_t HTTP_LATENCY_BUCKETS = sizeof(HTTP_LATENCY_BOUNDS_US) / sizeof(HTTP_LATENCY_BOUNDS_US[0]) + 1;
+
+struct HistogramSnapshot {
+    uint64_t buckets[HTTP_LATENCY_BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sumUs = 0;
+
+    // Upper bound of the bucket holding the given quantile, in milliseconds.
+    // 0 when empty; the last finite bound for the +Inf bucket.
+    double QuantileMs(double quantile) const;
+};
+
+// Fixed-bucket latency histogram. Record() is a handful of relaxed atomic
+// increments, so any thread can call it without locking.
+class LatencyHistogram {
+private:
+    std::atomic<uint64_t> buckets[HTTP_LATENCY_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sumUs;
+
+public:
+    LatencyHistogram();
+    void Record(uint64_t microseconds);
+    HistogramSnapshot Snapshot() const;
+};
+
+struct HTTPTimings {
+    bool newConnection = false;
+    // libcurl's cumulative timers, in microseconds from the start of the
+    // transfer.
+    int64_t nameLookupUs = 0;
+    int64_t connectUs = 0;
+    int64_t appConnectUs = 0;
+    int64_t startTransferUs = 0;
+    int64_t totalUs = 0;
+    // Body bytes, after any content decoding.
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+};
+
+struct EndpointSnapshot {
+    std::string endpoint;
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    HistogramSnapshot phases[static_cast<size_t>(HTTPPhase::Count)];
+};
+
+// Process-wide per-endpoint request metrics, keyed by URL path. Endpoints are
+// added to a fixed table with a compare-and-swap and never removed, so
+// recording takes no lock; paths beyond HTTP_METRICS_MAX_ENDPOINTS share an
+// "other" entry.
+class HTTPMetrics {
+private:
+    struct Endpoint {
+        std::string name;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<uint64_t> bytesSent{0};
+        std::atomic<uint64_t> bytesReceived{0};
+        LatencyHistogram phases[static_cast<size_t>(HTTPPhase::Count)];
+
+        explicit Endpoint(std::string endpointName) : name(std::move(endpointName)) {}
+    };
+
+    std::vector<std::atomic<Endpoint*>> slots;
+    Endpoint other;
+
+    HTTPMetrics();
+    ~HTTPMetrics();
+    HTTPMetrics(const HTTPMetrics&) = delete;
+    HTTPMetrics& operator=(const HTTPMetrics&) = delete;
+
+    Endpoint& Find(const std::string& url);
+
+public:
+    static HTTPMetrics& Instance();
+
+    void RecordSuccess(const std::string& url, const HTTPTimings& timings);
+    // Transport failures; cancelled requests are not counted.
+    void RecordFailure(const std::string& url);
+
+    // Upper bound of the bucket holding `quantile` of the endpoint's latency
+    // for `phase`, in milliseconds; -1 until `minCount` requests are recorded.
+    double QuantileMs(const std::string& url, HTTPPhase phase, double quantile, uint64_t minCount);
+
+    std::vector<EndpointSnapshot> Snapshot() const;
+    json ToJson() const;
+    // Prometheus text exposition format (version 0.0.4).
+    std::string ToPrometheus() const;
+    // Writes Prometheus text if `path` ends in ".prom", JSON otherwise.
+    bool WriteFile(const std::string& path) const;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef INFLIGHT_WINDOW_H
+#define INFLIGHT_WINDOW_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Bounds how many asynchronous requests are outstanding at once. The
+// submitting thread blocks in Acquire() while the window is full and each
+// completion callback calls Release().
+class InFlightWindow {
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t inFlight = 0;
+    std::size_t limit;
+
+public:
+    explicit InFlightWindow(std::size_t maxInFlight) : limit(maxInFlight ? maxInFlight : 1) {}
+
+    void Acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return inFlight < limit; });
+        inFlight++;
+    }
+
+    void Release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight--;
+        cv.notify_all();
+    }
+
+    void WaitIdle() {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return inFlight == 0; });
+    }
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef INTEGRITY_H
+#define INTEGRITY_H
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+
+// Process-wide binary integrity verification. The executable is hashed once
+// on a background thread, streamed through an incremental SHA-256 instead of
+// being copied into memory, and the verdict is cached for every later caller.
+// With INTEGRITY_RECHECK_INTERVAL > 0 the hash is refreshed in the background
+// once the last verification is older than the interval.
+class IntegrityVerifier {
+private:
+    std::mutex mutex;
+    std::shared_future<bool> pending;
+    bool hasResult;
+    bool lastResult;
+    std::chrono::steady_clock::time_point verifiedAt;
+
+    IntegrityVerifier();
+    IntegrityVerifier(const IntegrityVerifier&) = delete;
+    IntegrityVerifier& operator=(const IntegrityVerifier&) = delete;
+
+    static bool Run();
+    void StartLocked();
+
+public:
+    static IntegrityVerifier& Instance();
+
+    // Starts the background hash if it is not already running or done.
+    void Start();
+    // Returns the cached verdict, waiting only for the very first hash.
+    bool Verify();
+
+    static bool HashFile(const std::string& path, std::string& hexDigest);
+    static std::string ExecutablePath();
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef MIRROR_SET_H
+#define MIRROR_SET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Most mirrors a MirrorSet keeps; requests track the ones they tried in a
+// 32-bit mask.
+const size_t MIRROR_SET_MAX_MIRRORS = 32;
+
+struct MirrorStats {
+    std::string baseUrl;
+    unsigned long long requests;
+    unsigned long long failures;
+    // Latency EWMA; -1 until the mirror has answered once.
+    double latencyMs;
+    // Error rate EWMA, 0 to 1.
+    double errorRate;
+    bool healthy;
+};
+
+// Base URLs that serve the same API. Each mirror keeps an EWMA of its latency
+// and error rate; Pick() prefers the healthy mirror with the lowest latency,
+// inflated by MIRROR_ERROR_PENALTY times its error rate. Mirrors that have
+// not answered yet rank after those that have, in list order. A mirror that
+// failed MIRROR_MAX_FAILURES times in a row is skipped for
+// MIRROR_RETRY_SECONDS unless every mirror is in that state.
+// Thread-safe: all state is atomic and the list is fixed at construction.
+class MirrorSet {
+private:
+    struct Mirror {
+        std::string baseUrl;
+        std::atomic<int64_t> latencyUs{-1};
+        // Error rate EWMA in parts per million.
+        std::atomic<int64_t> errorPpm{0};
+        std::atomic<unsigned> consecutiveFailures{0};
+        std::atomic<int64_t> lastFailureMs{0};
+        // Last time the mirror answered, failed or was probed.
+        std::atomic<int64_t> lastUsedMs{0};
+        std::atomic<unsigned long long> requests{0};
+        std::atomic<unsigned long long> failures{0};
+
+        explicit Mirror(std::string url) : baseUrl(std::move(url)) {}
+    };
+
+    std::vector<std::unique_ptr<Mirror>> mirrors;
+
+    static int64_t NowMs();
+    bool IsHealthy(const Mirror& mirror, int64_t nowMs) const;
+
+public:
+    // Trailing slashes are dropped; entries past MIRROR_SET_MAX_MIRRORS are
+    // ignored.
+    explicit MirrorSet(const std::vector<std::string>& baseUrls);
+
+    size_t Size() const { return mirrors.size(); }
+    const std::string& BaseUrl(int index) const { return mirrors[index]->baseUrl; }
+
+    // Index of the mirror whose base URL starts `url`, with the rest of
+    // `url` in `path`; -1 if none does.
+    int Match(const std::string& url, std::string& path) const;
+    // Best mirror whose bit is not set in `tried`; -1 once all are tried.
+    int Pick(uint32_t tried = 0) const;
+    // A mirror other than `current` that has not been used for
+    // MIRROR_PROBE_INTERVAL_SECONDS, marked as used so concurrent callers
+    // do not probe it too; -1 if none is due.
+    int ClaimProbe(int current);
+
+    void RecordSuccess(int index, int64_t latencyUs);
+    void RecordFailure(int index);
+
+    std::vector<MirrorStats> Stats() const;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multi-producer, single-consumer queue. Push never blocks or takes
+// a lock: a producer swaps itself in as the new head and then links the
+// previous head to it. Only one thread may call TryPop.
+//
+// A push is visible to TryPop once its link store lands, so TryPop can miss
+// an item whose producer is between the two steps. Producers that wake the
+// consumer after pushing make that harmless.
+template <typename T>
+class MpscQueue {
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        T value;
+
+        Node() : next(nullptr), value() {}
+        explicit Node(T&& item) : next(nullptr), value(std::move(item)) {}
+    };
+
+    std::atomic<Node*> head;  // most recently pushed node
+    Node* tail;               // consumer-owned; its value was already popped
+
+public:
+    MpscQueue() {
+        Node* stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~MpscQueue() {
+        while (tail) {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void Push(T item) {
+        Node* node = new Node(std::move(item));
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    bool TryPop(T& item) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        item = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+    bool Empty() const {
+        return tail->next.load(std::memory_order_acquire) == nullptr;
+    }
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <chrono>
+#include <cstdint>
+
+// Counts rendered frames and samples process CPU time so the cost of the
+// render loop can be checked. Report() prints one line per interval.
+class RenderStats {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point windowStart;
+    double cpuAtWindowStart;
+    uint64_t framesInWindow;
+    uint64_t totalFrames;
+    double interval;
+
+public:
+    explicit RenderStats(double reportIntervalSec);
+
+    void FrameRendered() {
+        framesInWindow++;
+        totalFrames++;
+    }
+
+    // Seconds until the next report is due; 0 once it is.
+    double SecondsUntilReport() const;
+    // Prints frames per second and CPU use since the previous report.
+    void Report(const char* mode);
+
+    uint64_t TotalFrames() const { return totalFrames; }
+
+    // User plus system CPU time consumed by this process, in seconds.
+    static double ProcessCpuSeconds();
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SESSION_CACHE_H
+#define SESSION_CACHE_H
+
+#include <string>
+#include <ctime>
+
+struct PersistedSession {
+    std::string username;
+    std::string sessionToken;
+    std::time_t expiresAt;
+    std::time_t verifiedAt;
+    std::string signature;
+};
+
+// Stores the current session on disk so the next launch can skip the login
+// round-trip. The file is sealed with AES-256-GCM under a key derived from
+// the hardware ID, so a copied file is useless on another machine and any
+// tampering fails authentication on load.
+class SessionCache {
+private:
+    std::string path;
+
+    static bool DeriveKey(const std::string& hwid, const unsigned char* salt, unsigned char* key);
+
+public:
+    SessionCache();
+    explicit SessionCache(const std::string& filePath);
+
+    bool Save(const PersistedSession& session, const std::string& hwid) const;
+    bool Load(PersistedSession& session, const std::string& hwid) const;
+    void Clear() const;
+
+    static std::string DefaultPath();
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include "http_client.h"
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using SessionId = std::uint32_t;
+
+enum class SessionState : std::uint8_t {
+    Free = 0,
+    Active,
+    Invalid,
+};
+
+struct SessionRefreshStats {
+    std::size_t checked;
+    std::size_t valid;
+    std::size_t invalid;
+    std::size_t failed;
+    std::size_t requests;
+    bool usedBatchEndpoint;
+};
+
+// Multi-session mode for headless agents that hold many licenses at once.
+// Sessions live in a structure-of-arrays table: tokens and usernames are
+// packed into one string arena and referenced by offset, while expiry and
+// state sit in their own contiguous arrays, so memory per session is a few
+// dozen bytes plus the strings themselves.
+//
+// Refresh() checks sessions against the backend in batches through
+// API_CHECK_SESSION_BATCH_ENDPOINT. If the backend does not implement the
+// batch route, it falls back to individual check-session requests pipelined
+// over the shared HTTP event loop. Not thread-safe; drive it from one thread.
+class SessionManager {
+private:
+    struct StringRef {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    std::vector<char> arena;
+    std::vector<StringRef> tokens;
+    std::vector<StringRef> usernames;
+    std::vector<std::time_t> expiresAt;
+    std::vector<SessionState> states;
+    std::vector<SessionId> freeSlots;
+    std::size_t garbageBytes;
+    std::size_t activeCount;
+
+    HTTPClient httpClient;
+    std::string batchEndpoint;
+    std::string checkEndpoint;
+    bool batchSupported;
+
+    StringRef Intern(const std::string& value);
+    std::string Lookup(StringRef ref) const;
+    void CompactArena();
+    json BuildSessionEntry(SessionId id) const;
+
+    void RefreshBatched(const std::vector<SessionId>& ids, std::vector<std::int8_t>& outcome,
+                        std::vector<std::time_t>& renewedExpiry, SessionRefreshStats& stats);
+    void RefreshPipelined(const std::vector<SessionId>& ids, const std::vector<std::size_t>& indices,
+                          std::vector<std::int8_t>& outcome,
+                          std::vector<std::time_t>& renewedExpiry, SessionRefreshStats& stats);
+
+public:
+    SessionManager();
+    explicit SessionManager(const std::string& apiBaseUrl);
+
+    SessionId Add(const std::string& username, const std::string& sessionToken, std::time_t expires);
+    void Remove(SessionId id);
+    void Reserve(std::size_t sessions, std::size_t averageStringBytes);
+
+    std::size_t Size() const;
+    bool Contains(SessionId id) const;
+    SessionState GetState(SessionId id) const;
+    std::time_t GetExpiresAt(SessionId id) const;
+    std::string GetUsername(SessionId id) const;
+    std::string GetSessionToken(SessionId id) const;
+    std::size_t MemoryUsage() const;
+
+    // Checks every active session (or the given subset) with the backend and
+    // updates state and expiry in place. Blocks until all checks finish.
+    // A check that gets no reply or a non-2xx status counts as failed and
+    // leaves the session as it was.
+    SessionRefreshStats RefreshAll();
+    SessionRefreshStats Refresh(const std::vector<SessionId>& ids);
+
+    // False skips the batch route and checks sessions individually, as after
+    // the backend answered it with 404, 405 or 501; true tries it again.
+    void SetBatchEnabled(bool enabled);
+    bool IsBatchEnabled() const;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SESSION_SIGNATURE_H
+#define SESSION_SIGNATURE_H
+
+#include <ctime>
+#include <string>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+// Ed25519 signatures over a session's username, hardware ID and expiry. The
+// server signs each session it issues or renews; the client checks the
+// signature against the public key built in as SESSION_SIGNING_PUBLIC_KEY
+// and can then confirm the session without a round trip.
+
+// The bytes that get signed. The session token is included as its SHA-256
+// so a signature cannot be moved onto another session.
+std::string SessionSignatureMessage(const std::string& username, const std::string& hwid,
+                                    std::time_t expiresAt, const std::string& sessionToken);
+
+class SessionSigner {
+private:
+    EVP_PKEY* key;
+
+public:
+    SessionSigner();
+    ~SessionSigner();
+    SessionSigner(const SessionSigner&) = delete;
+    SessionSigner& operator=(const SessionSigner&) = delete;
+
+    // Reads an Ed25519 private key in PEM form, as written by
+    // `openssl genpkey -algorithm ed25519`.
+    bool Load(const std::string& pemPath, std::string& error);
+    bool IsLoaded() const { return key != nullptr; }
+
+    // Hex-encoded signature, or an empty string on failure. Thread-safe.
+    std::string Sign(const std::string& message) const;
+};
+
+class SessionVerifier {
+private:
+    EVP_PKEY* key;
+
+public:
+    // An empty or unparsable PEM leaves the verifier disabled.
+    explicit SessionVerifier(const std::string& publicKeyPem);
+    ~SessionVerifier();
+    SessionVerifier(const SessionVerifier&) = delete;
+    SessionVerifier& operator=(const SessionVerifier&) = delete;
+
+    // Verifier for SESSION_SIGNING_PUBLIC_KEY.
+    static const SessionVerifier& Instance();
+
+    bool IsEnabled() const { return key != nullptr; }
+    // Thread-safe.
+    bool Verify(const std::string& message, const std::string& hexSignature) const;
+};
+
+#endif
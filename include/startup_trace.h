@@ -0,0 +1,74 @@
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Timeline of what startup spends its time on, written in the Chrome trace
+// event format (open it in chrome://tracing or ui.perfetto.dev). Off until
+// Enable(), and until then a span costs one flag check. Once enabled, spans
+// and marks from any thread are kept in memory until WriteFile().
+class StartupTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Times the enclosing scope as one span on the calling thread.
+    class Span {
+    private:
+        const char* name;
+        Clock::time_point start;
+        bool active;
+
+    public:
+        explicit Span(const char* spanName);
+        ~Span();
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    };
+
+    static StartupTrace& Instance();
+
+    // Starts recording; timestamps count from `origin`, normally the moment
+    // main() was entered. Call before any other thread records.
+    void Enable(Clock::time_point origin);
+    bool IsEnabled() const { return enabled; }
+
+    // Labels the calling thread's row in the timeline.
+    void NameThread(const char* name);
+    void AddSpan(const char* name, Clock::time_point start, Clock::time_point end);
+    // A point in time all rows share, such as the first frame.
+    void AddMark(const char* name);
+
+    bool WriteFile(const std::string& path);
+
+private:
+    struct Event {
+        std::string name;
+        int thread;
+        long long startUs;
+        // -1 for a mark.
+        long long durationUs;
+    };
+
+    std::atomic<bool> enabled;
+    Clock::time_point origin;
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::unordered_map<std::thread::id, int> threads;
+    std::vector<std::string> threadNames;
+
+    StartupTrace();
+    StartupTrace(const StartupTrace&) = delete;
+    StartupTrace& operator=(const StartupTrace&) = delete;
+
+    long long Micros(Clock::time_point time) const;
+    // Small per-thread number used as the trace's tid; caller holds mutex.
+    int ThreadIndexLocked();
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Body encodings the client and server can speak. JSON is always understood;
+// CBOR and MessagePack carry the same documents in roughly two thirds of the
+// bytes and are cheaper to encode and parse.
+enum class WireFormat {
+    Json,
+    Cbor,
+    MsgPack
+};
+
+const char* WireFormatName(WireFormat format);
+const char* WireFormatContentType(WireFormat format);
+// Accepts "json", "cbor" and "msgpack".
+bool WireFormatFromName(const std::string& name, WireFormat& format);
+// Matches a Content-Type header value, ignoring parameters and case.
+bool WireFormatFromContentType(const std::string& contentType, WireFormat& format);
+// Picks the format the peer ranks highest in an Accept header, JSON if it
+// names nothing we support. Explicit q-values are honoured; ties keep the
+// header's order.
+WireFormat NegotiateWireFormat(const std::string& accept);
+// Accept header value that asks for `preferred` and still takes JSON.
+std::string WireFormatAccept(WireFormat preferred);
+
+std::string EncodeBody(const json& document, WireFormat format);
+// Throws json::parse_error on malformed input, like json::parse.
+json DecodeBody(const std::string& body, WireFormat format);
+
+// Body of a request: a json document, or a flat object of string fields that
+// is written straight into the output buffer in any format without building
+// a document first. Refers to the strings it was given, which must outlive
+// it.
+class RequestBody {
+public:
+    static const size_t MAX_FIELDS = 8;
+
+    RequestBody();
+    RequestBody(const json& document);
+
+    // Throws std::length_error past MAX_FIELDS.
+    RequestBody& Add(const char* name, const std::string& value);
+    // Replaces the contents of `out`, reserving the encoded size up front.
+    void EncodeTo(WireFormat format, std::string& out) const;
+
+private:
+    struct Field {
+        const char* name;
+        size_t nameLength;
+        const std::string* value;
+    };
+
+    const json* document;
+    Field fields[MAX_FIELDS];
+    size_t fieldCount;
+};
+
+// Reads the named top-level fields of a body in one pass, without building a
+// document. Other fields and everything nested are skipped. A field present
+// with the wrong type throws json::type_error, as json::get would.
+class FieldReader {
+public:
+    FieldReader& String(const char* name, std::string& value);
+    FieldReader& Bool(const char* name, bool& value);
+    // Takes any number and truncates it, as json::get<int64_t> does.
+    FieldReader& Integer(const char* name, int64_t& value);
+
+    // Throws json::parse_error on malformed input, like DecodeBody.
+    void Read(const std::string& body, WireFormat format);
+    // Whether the last Read found `name`.
+    bool Has(const char* name) const;
+
+private:
+    friend class FieldReaderSax;
+
+    enum class Kind { String, Bool, Integer };
+    struct Slot {
+        const char* name;
+        Kind kind;
+        void* value;
+        bool found;
+    };
+
+    Slot slots[RequestBody::MAX_FIELDS];
+    size_t slotCount = 0;
+
+    FieldReader& Register(const char* name, Kind kind, void* value);
+};
+
+#endif
@@ -1,11 +1,12 @@
 #include "auth_handler.h"
 #include "http_client.h"
+#include "http_event_loop.h"
 #include "config.h"
+#include "hex.h"
+#include "integrity.h"
+#include "startup_trace.h"
 #include <iostream>
 #include <sstream>
-#include <iomanip>
-#include <fstream>
-#include <vector>
 #include <openssl/sha.h>
 #include <openssl/evp.h>
 
@@ -18,19 +19,55 @@
 #include <pwd.h>
 #endif
 
-AuthHandler::AuthHandler() : isAuthenticated(false) {
-    if (!VerifyIntegrity()) {
-        std::cerr << "Integrity check failed!" << std::endl;
-    }
+AuthHandler::AuthHandler() : AuthHandler(API_BASE_URL) {
+}
+
+AuthHandler::AuthHandler(const std::string& apiBaseUrl)
+    : isAuthenticated(false),
+      localSessionChecks(0),
+      coalescedSessionChecks(0),
+      persistSession(SESSION_RESUME_ENABLED),
+      hedgeCheckSession(HEDGE_CHECK_SESSION),
+      sessionVerifier(&SessionVerifier::Instance()),
+      baseUrl(apiBaseUrl),
+      validateEndpoint(apiBaseUrl + API_VALIDATE_PATH),
+      checkSessionEndpoint(apiBaseUrl + API_CHECK_SESSION_PATH),
+      logoutEndpoint(apiBaseUrl + API_LOGOUT_PATH) {
+    hardwareId = HardwareId();
+    
+    HTTPRequestOptions options;
+    options.timeoutMs = API_VALIDATE_TIMEOUT_MS;
+    httpClient.SetEndpointOptions(validateEndpoint, options);
+    options.timeoutMs = API_CHECK_SESSION_TIMEOUT_MS;
+    httpClient.SetEndpointOptions(checkSessionEndpoint, options);
+    options.timeoutMs = API_LOGOUT_TIMEOUT_MS;
+    httpClient.SetEndpointOptions(logoutEndpoint, options);
+    SetMirrors(API_MIRROR_BASE_URLS);
+    // Hashing the executable runs in the background; ValidateKey only waits
+    // for it if the user manages to submit before it finishes.
+    IntegrityVerifier::Instance().Start();
 }
 
 AuthHandler::~AuthHandler() {
-    if (isAuthenticated) {
-        Logout();
+    // With resume enabled the server session must survive exit so the next
+    // launch can pick it up; only an explicit Logout() ends it. Otherwise the
+    // logout is fire-and-forget under a short deadline: exit never waits on
+    // the network, and a logout that does not land just lets the session
+    // expire on the server.
+    std::shared_ptr<const SessionState> state = CurrentSession();
+    if (isAuthenticated && !persistSession && state && !state->token.empty()) {
+        httpClient.PostAsync(logoutEndpoint, BuildSessionRequest(*state), [](const HTTPResponse&) {},
+                             OperationContext::WithTimeout(std::chrono::milliseconds(LOGOUT_ON_EXIT_TIMEOUT_MS)));
     }
 }
 
+const std::string& AuthHandler::HardwareId() {
+    static const std::string hwid = GenerateHWID();
+    return hwid;
+}
+
 std::string AuthHandler::GenerateHWID() {
+    StartupTrace::Span span("hwid");
     std::string hwid_data;
     
 #ifdef _WIN32
@@ -61,13 +98,7 @@ std::string AuthHandler::GenerateHWID() {
     SHA256(reinterpret_cast<const unsigned char*>(hwid_data.c_str()), 
            hwid_data.length(), hash);
     
-    std::stringstream hwid;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        hwid << std::hex << std::setw(2) << std::setfill('0') 
-             << static_cast<int>(hash[i]);
-    }
-    
-    return hwid.str();
+    return HexEncode(hash, sizeof(hash));
 }
 
 std::string AuthHandler::EncryptKey(const std::string& key) {
@@ -75,75 +106,40 @@ std::string AuthHandler::EncryptKey(const std::string& key) {
     SHA256(reinterpret_cast<const unsigned char*>(key.c_str()), 
            key.length(), hash);
     
-    std::stringstream ss;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        ss << std::hex << std::setw(2) << std::setfill('0') 
-           << static_cast<int>(hash[i]);
-    }
-    
-    return ss.str();
+    return HexEncode(hash, sizeof(hash));
 }
 
 bool AuthHandler::VerifyIntegrity() {
-    #ifdef ENABLE_INTEGRITY_CHECK
-    
-    std::ifstream exe(
-        #ifdef _WIN32
-        "LoginSys.exe"
-        #else
-        "/proc/self/exe"
-        #endif
-    , std::ios::binary);
-    
-    if (!exe.is_open()) {
-        return false;
-    }
-    
-    std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(exe), {});
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(buffer.data(), buffer.size(), hash);
-    
-    std::stringstream checksumStream;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        checksumStream << std::hex << std::setw(2) << std::setfill('0') 
-                      << static_cast<int>(hash[i]);
-    }
-    
-    std::string calculatedChecksum = checksumStream.str();
-    std::string expectedChecksum = EXPECTED_BINARY_CHECKSUM;
-    
-    return calculatedChecksum == expectedChecksum;
-    
-    #else
-    return true;
-    #endif
+    return IntegrityVerifier::Instance().Verify();
 }
 
-AuthResult AuthHandler::ValidateKey(const std::string& username, const std::string& key) {
-    AuthResult result;
+bool AuthHandler::BuildValidateRequest(const std::string& username, const std::string& key,
+                                       std::string& encryptedKey, RequestBody& requestData, AuthResult& result) {
     result.success = false;
+    result.expiresAt = 0;
     
     if (!VerifyIntegrity()) {
         result.message = "Application integrity compromised!";
-        return result;
+        return false;
     }
     
     if (username.empty() || key.empty()) {
         result.message = "Username and key are required";
-        return result;
+        return false;
     }
     
-    std::string hwid = GenerateHWID();
-    std::string encryptedKey = EncryptKey(key);
-    
-    HTTPClient client;
-    json requestData;
-    requestData["username"] = username;
-    requestData["key"] = encryptedKey;
-    requestData["hwid"] = hwid;
-    requestData["app_version"] = APP_VERSION;
-    
-    HTTPResponse response = client.Post(API_VALIDATE_ENDPOINT, requestData);
+    encryptedKey = EncryptKey(key);
+    requestData.Add("username", username)
+               .Add("key", encryptedKey)
+               .Add("hwid", hardwareId)
+               .Add("app_version", APP_VERSION);
+    return true;
+}
+
+AuthResult AuthHandler::ParseValidateResponse(const HTTPResponse& response) {
+    AuthResult result;
+    result.success = false;
+    result.expiresAt = 0;
     
     if (!response.success) {
         result.message = "Failed to connect to server";
@@ -151,37 +147,40 @@ AuthResult AuthHandler::ValidateKey(const std::string& username, const std::stri
     }
     
     try {
-        json responseData = json::parse(response.body);
+        bool success = false;
+        int64_t expiresAt = 0;
+        std::string message;
+        std::string error;
+        FieldReader fields;
+        fields.Bool("success", success)
+              .String("session_token", result.sessionToken)
+              .Integer("expires_at", expiresAt)
+              .String("signature", result.signature)
+              .String("message", message)
+              .String("error", error)
+              .Read(response.body, response.format);
         
-        if (responseData.contains("success") && responseData["success"].get<bool>()) {
+        if (success) {
             result.success = true;
             result.message = "Login successful";
-            
-            if (responseData.contains("session_token")) {
-                currentSessionToken = responseData["session_token"].get<std::string>();
-                result.sessionToken = currentSessionToken;
-            }
-            
-            if (responseData.contains("expires_at")) {
-                result.expiresAt = responseData["expires_at"].get<std::time_t>();
-            }
-            
-            currentUsername = username;
-            isAuthenticated = true;
-            
+            result.expiresAt = static_cast<std::time_t>(expiresAt);
         } else {
             result.success = false;
+            result.sessionToken.clear();
+            result.signature.clear();
             
-            if (responseData.contains("message")) {
-                result.message = responseData["message"].get<std::string>();
-            } else if (responseData.contains("error")) {
-                result.message = responseData["error"].get<std::string>();
+            if (fields.Has("message")) {
+                result.message = std::move(message);
+            } else if (fields.Has("error")) {
+                result.message = std::move(error);
             } else {
                 result.message = "Invalid credentials";
             }
         }
         
     } catch (const json::exception& e) {
+        result.sessionToken.clear();
+        result.signature.clear();
         result.message = "Invalid server response";
         std::cerr << "JSON parse error: " << e.what() << std::endl;
     }
@@ -189,26 +188,144 @@ AuthResult AuthHandler::ValidateKey(const std::string& username, const std::stri
     return result;
 }
 
-bool AuthHandler::CheckSession() {
-    if (!isAuthenticated || currentSessionToken.empty()) {
-        return false;
+AuthResult AuthHandler::HandleValidateResponse(const std::string& username, const HTTPResponse& response) {
+    AuthResult result = ParseValidateResponse(response);
+    
+    if (result.success) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        std::shared_ptr<const SessionState> current = CurrentSession();
+        auto next = std::make_shared<SessionState>();
+        next->token = result.sessionToken.empty() && current ? current->token : result.sessionToken;
+        next->username = username;
+        next->expiresAt = result.expiresAt;
+        next->lastVerifiedAt = std::time(nullptr);
+        next->signature = result.signature;
+        AdoptSignature(*next);
+        PersistSession(*next);
+        PublishSession(std::move(next));
+        isAuthenticated = true;
+    }
+    
+    return result;
+}
+
+AuthResult AuthHandler::ValidateKey(const std::string& username, const std::string& key,
+                                    const OperationContext& context) {
+    AuthResult result;
+    std::string encryptedKey;
+    RequestBody requestData;
+    if (!BuildValidateRequest(username, key, encryptedKey, requestData, result)) {
+        return result;
     }
     
-    HTTPClient client;
-    json requestData;
-    requestData["session_token"] = currentSessionToken;
-    requestData["username"] = currentUsername;
+    HTTPResponse response = httpClient.Post(validateEndpoint, requestData, context);
+    return HandleValidateResponse(username, response);
+}
+
+void AuthHandler::ValidateKeyAsync(const std::string& username, const std::string& key,
+                                   std::function<void(const AuthResult&)> callback,
+                                   const OperationContext& context) {
+    AuthResult result;
+    std::string encryptedKey;
+    RequestBody requestData;
+    if (!BuildValidateRequest(username, key, encryptedKey, requestData, result)) {
+        callback(result);
+        return;
+    }
     
-    HTTPResponse response = client.Post(API_CHECK_SESSION_ENDPOINT, requestData);
+    httpClient.PostAsync(validateEndpoint, requestData,
+        [this, username, callback](const HTTPResponse& response) {
+            callback(HandleValidateResponse(username, response));
+        }, context);
+}
+
+void AuthHandler::ValidateCredentialsAsync(const std::string& username, const std::string& key,
+                                           std::function<void(const AuthResult&)> callback,
+                                           const OperationContext& context) {
+    AuthResult result;
+    std::string encryptedKey;
+    RequestBody requestData;
+    if (!BuildValidateRequest(username, key, encryptedKey, requestData, result)) {
+        callback(result);
+        return;
+    }
     
+    httpClient.PostAsync(validateEndpoint, requestData,
+        [callback](const HTTPResponse& response) {
+            callback(ParseValidateResponse(response));
+        }, context);
+}
+
+std::future<AuthResult> AuthHandler::ValidateKeyAsync(const std::string& username, const std::string& key) {
+    auto promise = std::make_shared<std::promise<AuthResult>>();
+    std::future<AuthResult> future = promise->get_future();
+    ValidateKeyAsync(username, key, [promise](const AuthResult& result) {
+        promise->set_value(result);
+    });
+    return future;
+}
+
+struct AuthHandler::SessionCheck {
+    struct Waiter {
+        std::function<void(bool)> callback;
+        CancellationToken cancellation;
+        std::atomic<uint64_t> cancelCallback{0};
+        std::atomic<bool> done{false};
+    };
+    
+    std::string token;
+    CancellationToken requestToken = CancellationToken::Create();
+    // Guarded by checkMutex. `active` counts waiters that have not given up;
+    // when the last one does, the request is cancelled.
+    std::vector<std::shared_ptr<Waiter>> waiters;
+    size_t active = 0;
+};
+
+std::shared_ptr<const AuthHandler::SessionState> AuthHandler::CurrentSession() const {
+    return std::atomic_load(&session);
+}
+
+void AuthHandler::PublishSession(std::shared_ptr<SessionState> next) {
+    std::atomic_store(&session, std::shared_ptr<const SessionState>(std::move(next)));
+}
+
+RequestBody AuthHandler::BuildSessionRequest(const SessionState& state) const {
+    RequestBody requestData;
+    requestData.Add("session_token", state.token)
+               .Add("username", state.username)
+               .Add("hwid", hardwareId);
+    return requestData;
+}
+
+bool AuthHandler::HandleCheckSessionResponse(const std::string& token, const HTTPResponse& response) {
     if (!response.success) {
         return false;
     }
     
     try {
-        json responseData = json::parse(response.body);
+        bool valid = false;
+        int64_t expiresAt = 0;
+        std::string signature;
+        FieldReader fields;
+        fields.Bool("valid", valid)
+              .Integer("expires_at", expiresAt)
+              .String("signature", signature)
+              .Read(response.body, response.format);
         
-        if (responseData.contains("valid") && responseData["valid"].get<bool>()) {
+        if (valid) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            std::shared_ptr<const SessionState> current = CurrentSession();
+            // A login or logout may have replaced the session meanwhile.
+            if (current && current->token == token) {
+                auto next = std::make_shared<SessionState>(*current);
+                if (fields.Has("expires_at")) {
+                    next->expiresAt = static_cast<std::time_t>(expiresAt);
+                }
+                next->lastVerifiedAt = std::time(nullptr);
+                next->signature = std::move(signature);
+                AdoptSignature(*next);
+                PublishSession(std::move(next));
+            }
             return true;
         }
         
@@ -216,29 +333,358 @@ bool AuthHandler::CheckSession() {
         std::cerr << "Session check error: " << e.what() << std::endl;
     }
     
-    isAuthenticated = false;
+    std::lock_guard<std::mutex> lock(stateMutex);
+    std::shared_ptr<const SessionState> current = CurrentSession();
+    if (current && current->token == token) {
+        isAuthenticated = false;
+    }
     return false;
 }
 
-void AuthHandler::Logout() {
-    if (!currentSessionToken.empty()) {
-        HTTPClient client;
-        json requestData;
-        requestData["session_token"] = currentSessionToken;
-        requestData["username"] = currentUsername;
-        
-        client.Post(API_LOGOUT_ENDPOINT, requestData);
+void AuthHandler::AdoptSignature(SessionState& state) const {
+    state.signedExpiresAt = 0;
+    if (!state.signature.empty() && sessionVerifier && sessionVerifier->IsEnabled() &&
+        sessionVerifier->Verify(SessionSignatureMessage(state.username, hardwareId, state.expiresAt,
+                                                        state.token), state.signature)) {
+        state.signedExpiresAt = state.expiresAt;
+    }
+}
+
+bool AuthHandler::CheckSessionLocally(const SessionState& state) {
+    if (state.signedExpiresAt == 0 || state.signedExpiresAt != state.expiresAt) {
+        return false;
     }
     
-    currentSessionToken.clear();
-    currentUsername.clear();
-    isAuthenticated = false;
+    // The signature proves who the session was issued to, not that it is
+    // still live, so the server is asked again once the last confirmation
+    // is old enough that a revocation might have been missed.
+    std::time_t now = std::time(nullptr);
+    if (now < state.lastVerifiedAt || now - state.lastVerifiedAt >= SESSION_LOCAL_CHECK_MAX_AGE ||
+        state.expiresAt <= now + SESSION_LOCAL_CHECK_MIN_REMAINING) {
+        return false;
+    }
+    localSessionChecks.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void AuthHandler::SendSessionCheck(const std::shared_ptr<const SessionState>& state,
+                                   const OperationContext& context, std::function<void(bool)> callback) {
+    std::string token = state->token;
+    auto onResponse = [this, token, callback](const HTTPResponse& response) {
+        callback(HandleCheckSessionResponse(token, response));
+    };
+    if (hedgeCheckSession) {
+        httpClient.PostHedgedAsync(checkSessionEndpoint, BuildSessionRequest(*state), onResponse, context);
+    } else {
+        httpClient.PostAsync(checkSessionEndpoint, BuildSessionRequest(*state), onResponse, context);
+    }
+}
+
+void AuthHandler::FinishSessionCheck(const std::shared_ptr<SessionCheck>& check, const std::string& token,
+                                     bool valid) {
+    std::vector<std::shared_ptr<SessionCheck::Waiter>> waiters;
+    {
+        std::lock_guard<std::mutex> lock(checkMutex);
+        if (checkInFlight == check) {
+            checkInFlight.reset();
+        }
+        if (valid) {
+            checkCachedToken = token;
+            checkCachedUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(SESSION_CHECK_CACHE_MS);
+        }
+        waiters.swap(check->waiters);
+    }
+    
+    for (auto& waiter : waiters) {
+        waiter->cancellation.RemoveCallback(waiter->cancelCallback.load());
+        if (!waiter->done.exchange(true)) {
+            waiter->callback(valid);
+        }
+    }
+}
+
+bool AuthHandler::CheckSession(const OperationContext& context) {
+    if (HTTPEventLoop::Instance().IsLoopThread()) {
+        // Waiting here would block the thread that has to complete the
+        // check, and a blocking transfer would stall every other one. Answer
+        // from what is known locally and let a shared check run behind it.
+        std::shared_ptr<const SessionState> state = CurrentSession();
+        if (!isAuthenticated || !state || state->token.empty()) {
+            return false;
+        }
+        if (CheckSessionLocally(*state)) {
+            return true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(checkMutex);
+            if (checkCachedToken == state->token && std::chrono::steady_clock::now() < checkCachedUntil) {
+                return true;
+            }
+        }
+        CheckSessionAsync([](bool) {}, context);
+        return isAuthenticated;
+    }
+    
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    CheckSessionAsync([promise](bool valid) {
+        promise->set_value(valid);
+    }, context);
+    return future.get();
+}
+
+void AuthHandler::CheckSessionAsync(std::function<void(bool)> callback, const OperationContext& context) {
+    std::shared_ptr<const SessionState> state = CurrentSession();
+    if (!isAuthenticated || !state || state->token.empty()) {
+        callback(false);
+        return;
+    }
+    if (CheckSessionLocally(*state)) {
+        callback(true);
+        return;
+    }
+    
+    auto waiter = std::make_shared<SessionCheck::Waiter>();
+    waiter->callback = std::move(callback);
+    waiter->cancellation = context.cancellation;
+    
+    std::shared_ptr<SessionCheck> check;
+    bool cached = false;
+    bool start = false;
+    {
+        std::lock_guard<std::mutex> lock(checkMutex);
+        if (checkCachedToken == state->token && std::chrono::steady_clock::now() < checkCachedUntil) {
+            cached = true;
+        } else {
+            if (!checkInFlight || checkInFlight->token != state->token) {
+                checkInFlight = std::make_shared<SessionCheck>();
+                checkInFlight->token = state->token;
+                start = true;
+            }
+            check = checkInFlight;
+            check->waiters.push_back(waiter);
+            check->active++;
+        }
+    }
+    
+    if (cached) {
+        waiter->callback(true);
+        return;
+    }
+    if (!start) {
+        coalescedSessionChecks.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // A caller that gives up gets its answer now; the request is only
+    // cancelled once every caller waiting on it has given up.
+    if (context.cancellation.CanBeCancelled()) {
+        uint64_t id = waiter->cancellation.OnCancel([this, check, waiter]() {
+            if (!waiter->done.exchange(true)) {
+                waiter->callback(false);
+            }
+            bool abandoned = false;
+            {
+                std::lock_guard<std::mutex> lock(checkMutex);
+                abandoned = --check->active == 0 && checkInFlight == check;
+            }
+            if (abandoned) {
+                check->requestToken.Cancel();
+            }
+        });
+        waiter->cancelCallback = id;
+        if (waiter->done.load()) {
+            waiter->cancellation.RemoveCallback(id);
+        }
+    }
+    
+    if (start) {
+        // Bounded by the first caller's deadline; later callers share it.
+        OperationContext requestContext(check->requestToken);
+        requestContext.deadline = context.deadline;
+        std::string token = state->token;
+        SendSessionCheck(state, requestContext, [this, check, token](bool valid) {
+            FinishSessionCheck(check, token, valid);
+        });
+    }
+}
+
+std::future<bool> AuthHandler::CheckSessionAsync() {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    CheckSessionAsync([promise](bool valid) {
+        promise->set_value(valid);
+    });
+    return future;
+}
+
+void AuthHandler::Logout(const OperationContext& context) {
+    std::shared_ptr<const SessionState> state = CurrentSession();
+    if (state && !state->token.empty()) {
+        httpClient.Post(logoutEndpoint, BuildSessionRequest(*state), context);
+    }
+    
+    ClearSessionState();
+    if (persistSession) {
+        sessionCache.Clear();
+    }
+}
+
+bool AuthHandler::Preconnect(const OperationContext& context) {
+    return httpClient.Preconnect(validateEndpoint, context);
+}
+
+void AuthHandler::ClearSessionState() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        PublishSession(nullptr);
+        isAuthenticated = false;
+    }
+    std::lock_guard<std::mutex> lock(checkMutex);
+    checkCachedToken.clear();
+}
+
+void AuthHandler::PersistSession(const SessionState& state) {
+    if (!persistSession || state.token.empty()) {
+        return;
+    }
+    
+    PersistedSession saved;
+    saved.username = state.username;
+    saved.sessionToken = state.token;
+    saved.expiresAt = state.expiresAt;
+    saved.verifiedAt = state.lastVerifiedAt;
+    saved.signature = state.signature;
+    
+    if (!sessionCache.Save(saved, hardwareId)) {
+        std::cerr << "Failed to persist session" << std::endl;
+    }
+}
+
+void AuthHandler::ResumeSessionAsync(std::function<void(bool)> callback, const OperationContext& context) {
+    PersistedSession saved;
+    if (!persistSession || !sessionCache.Load(saved, hardwareId)) {
+        callback(false);
+        return;
+    }
+    
+    std::time_t now = std::time(nullptr);
+    if (saved.expiresAt != 0 && saved.expiresAt <= now + SESSION_RESUME_MIN_REMAINING) {
+        sessionCache.Clear();
+        callback(false);
+        return;
+    }
+    
+    auto next = std::make_shared<SessionState>();
+    next->username = saved.username;
+    next->token = saved.sessionToken;
+    next->expiresAt = saved.expiresAt;
+    next->lastVerifiedAt = saved.verifiedAt;
+    next->signature = saved.signature;
+    AdoptSignature(*next);
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        PublishSession(std::move(next));
+        isAuthenticated = true;
+    }
+    
+    if (now >= saved.verifiedAt && now - saved.verifiedAt < SESSION_RESUME_OFFLINE_GRACE) {
+        callback(true);
+        return;
+    }
+    
+    CheckSessionAsync([this, callback](bool valid) {
+        if (valid) {
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                std::shared_ptr<const SessionState> state = CurrentSession();
+                if (state) {
+                    PersistSession(*state);
+                }
+            }
+            callback(true);
+            return;
+        }
+        
+        // HandleCheckSessionResponse clears isAuthenticated only when the
+        // server rejected the token; a network failure keeps the cache so
+        // the next launch can try again.
+        if (!isAuthenticated) {
+            sessionCache.Clear();
+        }
+        ClearSessionState();
+        callback(false);
+    }, context);
+}
+
+bool AuthHandler::ResumeSession(const OperationContext& context) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    ResumeSessionAsync([promise](bool resumed) {
+        promise->set_value(resumed);
+    }, context);
+    return future.get();
+}
+
+void AuthHandler::SetSessionPersistence(bool enabled) {
+    persistSession = enabled;
+}
+
+void AuthHandler::SetWireFormat(WireFormat preferred) {
+    httpClient.SetWireFormat(preferred);
+}
+
+void AuthHandler::SetHttpVersion(HTTPVersion version) {
+    httpClient.SetHttpVersion(version);
+}
+
+void AuthHandler::SetHedging(bool enabled) {
+    hedgeCheckSession = enabled;
+}
+
+HedgeStats AuthHandler::GetHedgeStats() const {
+    return httpClient.GetHedgeStats();
+}
+
+void AuthHandler::SetMirrors(const std::vector<std::string>& mirrorBaseUrls) {
+    std::vector<std::string> baseUrls;
+    baseUrls.push_back(baseUrl);
+    baseUrls.insert(baseUrls.end(), mirrorBaseUrls.begin(), mirrorBaseUrls.end());
+    httpClient.SetMirrors(baseUrls);
+}
+
+std::vector<MirrorStats> AuthHandler::GetMirrorStats() const {
+    return httpClient.GetMirrorStats();
+}
+
+void AuthHandler::SetSessionVerifier(const SessionVerifier* verifier) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    sessionVerifier = verifier;
+    std::shared_ptr<const SessionState> current = CurrentSession();
+    if (current) {
+        auto next = std::make_shared<SessionState>(*current);
+        AdoptSignature(*next);
+        PublishSession(std::move(next));
+    }
+}
+
+unsigned long long AuthHandler::GetLocalSessionChecks() const {
+    return localSessionChecks.load(std::memory_order_relaxed);
+}
+
+unsigned long long AuthHandler::GetCoalescedSessionChecks() const {
+    return coalescedSessionChecks.load(std::memory_order_relaxed);
 }
 
 bool AuthHandler::IsAuthenticated() const {
-    return isAuthenticated;
+    return isAuthenticated.load();
 }
 
 std::string AuthHandler::GetUsername() const {
-    return currentUsername;
+    std::shared_ptr<const SessionState> state = CurrentSession();
+    return state ? state->username : std::string();
+}
+
+std::time_t AuthHandler::GetExpiresAt() const {
+    std::shared_ptr<const SessionState> state = CurrentSession();
+    return state ? state->expiresAt : 0;
 }
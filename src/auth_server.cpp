@@ -0,0 +1,534 @@
+#include "auth_server.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int MAX_EVENTS = 256;
+const size_t READ_CHUNK = 16 * 1024;
+const int SESSION_PURGE_INTERVAL_SEC = 60;
+
+const char* ReasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    default: return "Error";
+    }
+}
+
+bool EqualsIgnoreCase(const char* a, size_t aLength, const char* b) {
+    size_t bLength = std::strlen(b);
+    if (aLength != bLength) {
+        return false;
+    }
+    for (size_t i = 0; i < aLength; i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+using SteadyClock = std::chrono::steady_clock;
+
+struct AuthServer::Connection {
+    int fd;
+    std::string in;
+    std::string out;
+    size_t outOffset = 0;
+    bool closeAfterWrite = false;
+    bool watchingWrite = false;
+    // Set once "100 Continue" went out for the request at the head of `in`.
+    bool continueSent = false;
+    SteadyClock::time_point lastActive;
+};
+
+class AuthServer::EventLoop {
+private:
+    const AuthServerConfig& config;
+    AuthService& service;
+    bool purgesSessions;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+
+    void Accept();
+    void OnReadable(Connection& conn);
+    bool Flush(Connection& conn);
+    void ProcessRequests(Connection& conn);
+    void AppendResponse(Connection& conn, int status, const std::string& body, bool keepAlive,
+                        WireFormat format = WireFormat::Json, bool includeBody = true);
+    void Close(int fd);
+    void SweepIdle(SteadyClock::time_point now);
+
+public:
+    EventLoop(const AuthServerConfig& serverConfig, AuthService& authService, bool purgeSessions)
+        : config(serverConfig), service(authService), purgesSessions(purgeSessions) {}
+    ~EventLoop();
+
+    bool Open(std::string& error);
+    void Run(std::atomic<bool>& running);
+    void Wake();
+};
+
+AuthServer::EventLoop::~EventLoop() {
+    for (auto& entry : connections) {
+        close(entry.first);
+    }
+    if (listenFd >= 0) close(listenFd);
+    if (epollFd >= 0) close(epollFd);
+    if (wakeFd >= 0) close(wakeFd);
+}
+
+bool AuthServer::EventLoop::Open(std::string& error) {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        error = std::string("SO_REUSEPORT: ") + std::strerror(errno);
+        return false;
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(config.port));
+    if (inet_pton(AF_INET, config.bindAddress.c_str(), &addr.sin_addr) != 1) {
+        error = "invalid bind address " + config.bindAddress;
+        return false;
+    }
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        error = std::string("bind: ") + std::strerror(errno);
+        return false;
+    }
+    if (listen(listenFd, SOMAXCONN) != 0) {
+        error = std::string("listen: ") + std::strerror(errno);
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        error = std::string("epoll/eventfd: ") + std::strerror(errno);
+        return false;
+    }
+
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+    return true;
+}
+
+void AuthServer::EventLoop::Wake() {
+    uint64_t value = 1;
+    ssize_t written = write(wakeFd, &value, sizeof(value));
+    (void)written;
+}
+
+void AuthServer::EventLoop::Run(std::atomic<bool>& running) {
+    epoll_event events[MAX_EVENTS];
+    SteadyClock::time_point lastSweep = SteadyClock::now();
+    SteadyClock::time_point lastPurge = lastSweep;
+
+    while (running.load(std::memory_order_relaxed)) {
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, 1000);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == listenFd) {
+                Accept();
+                continue;
+            }
+            if (fd == wakeFd) {
+                uint64_t value;
+                ssize_t drained = read(wakeFd, &value, sizeof(value));
+                (void)drained;
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            Connection& conn = *it->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                Close(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                if (!Flush(conn)) {
+                    continue;
+                }
+            }
+            if (events[i].events & EPOLLIN) {
+                OnReadable(conn);
+            }
+        }
+
+        SteadyClock::time_point now = SteadyClock::now();
+        if (now - lastSweep >= std::chrono::seconds(1)) {
+            SweepIdle(now);
+            lastSweep = now;
+        }
+        if (purgesSessions && now - lastPurge >= std::chrono::seconds(SESSION_PURGE_INTERVAL_SEC)) {
+            service.PurgeExpiredSessions();
+            lastPurge = now;
+        }
+    }
+}
+
+void AuthServer::EventLoop::Accept() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::unique_ptr<Connection> conn(new Connection());
+        conn->fd = fd;
+        conn->lastActive = SteadyClock::now();
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        connections.emplace(fd, std::move(conn));
+    }
+}
+
+void AuthServer::EventLoop::OnReadable(Connection& conn) {
+    char buffer[READ_CHUNK];
+    bool peerClosed = false;
+
+    while (true) {
+        ssize_t received = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            conn.in.append(buffer, static_cast<size_t>(received));
+            // Handle each chunk as it arrives so an oversized request is
+            // refused at the limit instead of after the whole socket drains.
+            ProcessRequests(conn);
+            if (conn.closeAfterWrite) {
+                break;
+            }
+            continue;
+        }
+        if (received == 0) {
+            peerClosed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            peerClosed = true;
+        }
+        break;
+    }
+
+    conn.lastActive = SteadyClock::now();
+    int fd = conn.fd;
+
+    if (peerClosed) {
+        // Finish writing whatever the peer already asked for, then close.
+        conn.closeAfterWrite = true;
+    }
+    if (!Flush(conn)) {
+        return;
+    }
+    if (peerClosed) {
+        // Stop watching input: a half-closed socket stays readable forever.
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+    }
+}
+
+void AuthServer::EventLoop::ProcessRequests(Connection& conn) {
+    size_t consumed = 0;
+
+    while (!conn.closeAfterWrite) {
+        size_t headerEnd = conn.in.find("\r\n\r\n", consumed);
+        if (headerEnd == std::string::npos) {
+            if (conn.in.size() - consumed > config.maxHeaderBytes) {
+                AppendResponse(conn, 431, R"({"success":false,"message":"Headers too large"})", false);
+            }
+            break;
+        }
+
+        const char* data = conn.in.data() + consumed;
+        size_t headerLength = headerEnd - consumed;
+        if (headerLength > config.maxHeaderBytes) {
+            AppendResponse(conn, 431, R"({"success":false,"message":"Headers too large"})", false);
+            break;
+        }
+        size_t lineEnd = conn.in.find("\r\n", consumed);
+
+        std::string requestLine = conn.in.substr(consumed, lineEnd - consumed);
+        size_t methodEnd = requestLine.find(' ');
+        size_t pathEnd = methodEnd == std::string::npos ? std::string::npos : requestLine.find(' ', methodEnd + 1);
+        if (pathEnd == std::string::npos) {
+            AppendResponse(conn, 400, R"({"success":false,"message":"Bad request line"})", false);
+            break;
+        }
+        std::string method = requestLine.substr(0, methodEnd);
+        std::string path = requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+        std::string version = requestLine.substr(pathEnd + 1);
+
+        size_t contentLength = 0;
+        bool keepAlive = version == "HTTP/1.1";
+        bool encodedBody = false;
+        bool expectContinue = false;
+        std::string contentType;
+        std::string accept;
+
+        size_t pos = lineEnd - consumed + 2;
+        while (pos < headerLength) {
+            size_t end = conn.in.find("\r\n", consumed + pos) - consumed;
+            if (end > headerLength) {
+                end = headerLength;
+            }
+            const char* line = data + pos;
+            size_t lineLength = end - pos;
+            const char* colon = static_cast<const char*>(std::memchr(line, ':', lineLength));
+            if (colon) {
+                size_t nameLength = colon - line;
+                const char* value = colon + 1;
+                size_t valueLength = lineLength - nameLength - 1;
+                while (valueLength > 0 && (*value == ' ' || *value == '\t')) {
+                    value++;
+                    valueLength--;
+                }
+
+                if (EqualsIgnoreCase(line, nameLength, "content-length")) {
+                    contentLength = std::strtoul(std::string(value, valueLength).c_str(), nullptr, 10);
+                } else if (EqualsIgnoreCase(line, nameLength, "connection")) {
+                    if (EqualsIgnoreCase(value, valueLength, "close")) {
+                        keepAlive = false;
+                    } else if (EqualsIgnoreCase(value, valueLength, "keep-alive")) {
+                        keepAlive = true;
+                    }
+                } else if (EqualsIgnoreCase(line, nameLength, "transfer-encoding")) {
+                    // identity means no encoding; chunked and the compressed
+                    // codings are not decoded here.
+                    encodedBody = !EqualsIgnoreCase(value, valueLength, "identity");
+                } else if (EqualsIgnoreCase(line, nameLength, "expect")) {
+                    expectContinue = EqualsIgnoreCase(value, valueLength, "100-continue");
+                } else if (EqualsIgnoreCase(line, nameLength, "content-type")) {
+                    contentType.assign(value, valueLength);
+                } else if (EqualsIgnoreCase(line, nameLength, "accept")) {
+                    accept.assign(value, valueLength);
+                }
+            }
+            pos = end + 2;
+        }
+
+        if (encodedBody) {
+            AppendResponse(conn, 501, R"({"success":false,"message":"Transfer-Encoding not supported"})", false);
+            break;
+        }
+        if (contentLength > config.maxBodyBytes) {
+            AppendResponse(conn, 413, R"({"success":false,"message":"Body too large"})", false);
+            break;
+        }
+
+        size_t bodyStart = headerEnd + 4;
+        if (conn.in.size() - bodyStart < contentLength) {
+            // libcurl waits for this before sending larger POST bodies.
+            if (expectContinue && !conn.continueSent) {
+                conn.out.append("HTTP/1.1 100 Continue\r\n\r\n");
+                conn.continueSent = true;
+            }
+            break;
+        }
+
+        std::string body = conn.in.substr(bodyStart, contentLength);
+        consumed = bodyStart + contentLength;
+        conn.continueSent = false;
+
+        ServiceResponse response = service.Handle(method, path, contentType, accept, body);
+        // HEAD replies (client pre-connects) carry the headers only, or the
+        // body would be read as the start of the next response.
+        AppendResponse(conn, response.status, response.body, keepAlive, response.format, method != "HEAD");
+    }
+
+    conn.in.erase(0, consumed);
+}
+
+void AuthServer::EventLoop::AppendResponse(Connection& conn, int status, const std::string& body, bool keepAlive,
+                                           WireFormat format, bool includeBody) {
+    char header[256];
+    int length = snprintf(header, sizeof(header),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "%s"
+        "\r\n",
+        status, ReasonPhrase(status), WireFormatContentType(format), body.size(),
+        keepAlive ? "" : "Connection: close\r\n");
+
+    conn.out.append(header, static_cast<size_t>(length));
+    if (includeBody) {
+        conn.out.append(body);
+    }
+    if (!keepAlive) {
+        conn.closeAfterWrite = true;
+    }
+}
+
+bool AuthServer::EventLoop::Flush(Connection& conn) {
+    while (conn.outOffset < conn.out.size()) {
+        ssize_t sent = send(conn.fd, conn.out.data() + conn.outOffset,
+                            conn.out.size() - conn.outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.outOffset += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!conn.watchingWrite) {
+                epoll_event ev;
+                std::memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+                ev.data.fd = conn.fd;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+                conn.watchingWrite = true;
+            }
+            return true;
+        }
+        Close(conn.fd);
+        return false;
+    }
+
+    conn.out.clear();
+    conn.outOffset = 0;
+
+    if (conn.closeAfterWrite) {
+        Close(conn.fd);
+        return false;
+    }
+    if (conn.watchingWrite) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = conn.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.watchingWrite = false;
+    }
+    return true;
+}
+
+void AuthServer::EventLoop::Close(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+void AuthServer::EventLoop::SweepIdle(SteadyClock::time_point now) {
+    std::vector<int> idle;
+    for (auto& entry : connections) {
+        if (now - entry.second->lastActive > std::chrono::seconds(config.idleTimeoutSec)) {
+            idle.push_back(entry.first);
+        }
+    }
+    for (int fd : idle) {
+        Close(fd);
+    }
+}
+
+AuthServer::AuthServer(const AuthServerConfig& serverConfig, AuthService& authService)
+    : config(serverConfig), service(authService) {
+}
+
+AuthServer::~AuthServer() {
+    Stop();
+    Wait();
+}
+
+bool AuthServer::Start(std::string& error) {
+    unsigned count = config.threads;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        std::unique_ptr<EventLoop> loop(new EventLoop(config, service, i == 0));
+        if (!loop->Open(error)) {
+            loops.clear();
+            return false;
+        }
+        loops.push_back(std::move(loop));
+    }
+
+    running.store(true);
+    for (auto& loop : loops) {
+        EventLoop* raw = loop.get();
+        threads.emplace_back([this, raw]() { raw->Run(running); });
+    }
+    return true;
+}
+
+void AuthServer::Stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    for (auto& loop : loops) {
+        loop->Wake();
+    }
+}
+
+void AuthServer::Wait() {
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
+
+unsigned AuthServer::LoopCount() const {
+    return static_cast<unsigned>(loops.size());
+}
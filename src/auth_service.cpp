@@ -0,0 +1,269 @@
+#include "auth_service.h"
+#include "config.h"
+#include "hex.h"
+#include <fstream>
+#include <sstream>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+AuthService::AuthService(const AuthServiceConfig& serviceConfig) : config(serviceConfig) {
+}
+
+bool AuthService::Open(std::string& error) {
+    if (!config.signingKeyFile.empty() && !signer.Load(config.signingKeyFile, error)) {
+        return false;
+    }
+    return store.Open(config.dataDir, error);
+}
+
+bool AuthService::Snapshot(std::string& error) {
+    return store.Snapshot(error);
+}
+
+void AuthService::Sync() {
+    store.Sync();
+}
+
+std::string AuthService::HashKey(const std::string& key) {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(key.c_str()), key.length(), hash);
+
+    return HexEncode(hash, sizeof(hash));
+}
+
+std::string AuthService::NewSessionToken() {
+    unsigned char bytes[32];
+    RAND_bytes(bytes, sizeof(bytes));
+    return HexEncode(bytes, sizeof(bytes));
+}
+
+void AuthService::AddLicense(const std::string& username, const std::string& keyHash, std::time_t expiresAt) {
+    store.UpsertLicense(Digest::FromValue(keyHash), Digest::Hash(username), expiresAt);
+}
+
+bool AuthService::LoadLicenses(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string username;
+        std::string key;
+        std::time_t expiresAt = 0;
+
+        if (!(fields >> username) || username[0] == '#') {
+            continue;
+        }
+        if (!(fields >> key)) {
+            error = path + ":" + std::to_string(lineNumber) + ": missing key";
+            return false;
+        }
+        fields >> expiresAt;
+
+        const std::string hashedPrefix = "sha256:";
+        std::string keyHash = key.compare(0, hashedPrefix.size(), hashedPrefix) == 0
+            ? key.substr(hashedPrefix.size())
+            : HashKey(key);
+        AddLicense(username, keyHash, expiresAt);
+    }
+    return true;
+}
+
+size_t AuthService::LicenseCount() {
+    return store.LicenseCount();
+}
+
+size_t AuthService::SessionCount() {
+    return store.SessionCount();
+}
+
+size_t AuthService::PurgeExpiredSessions() {
+    return store.PurgeExpiredSessions(std::time(nullptr));
+}
+
+ServiceResponse AuthService::Handle(const std::string& method, const std::string& path, const std::string& contentType,
+                                    const std::string& accept, const std::string& body) {
+    ServiceResponse response;
+    response.status = 200;
+    response.format = WireFormat::Json;
+
+    if (path.compare(0, config.pathPrefix.size(), config.pathPrefix) != 0) {
+        response.status = 404;
+        response.body = R"({"success":false,"message":"Not found"})";
+        return response;
+    }
+    std::string route = path.substr(config.pathPrefix.size());
+
+    bool known = route == API_VALIDATE_PATH || route == API_CHECK_SESSION_PATH ||
+                 route == API_CHECK_SESSION_BATCH_PATH || route == API_LOGOUT_PATH;
+    if (!known) {
+        response.status = 404;
+        response.body = R"({"success":false,"message":"Not found"})";
+        return response;
+    }
+    if (method != "POST") {
+        response.status = 405;
+        response.body = R"({"success":false,"message":"Method not allowed"})";
+        return response;
+    }
+
+    // No Content-Type is treated as JSON, as before negotiation existed.
+    WireFormat requestFormat = WireFormat::Json;
+    if (!contentType.empty() && !WireFormatFromContentType(contentType, requestFormat)) {
+        response.status = 415;
+        response.body = R"({"success":false,"message":"Unsupported content type"})";
+        return response;
+    }
+
+    json request;
+    try {
+        request = DecodeBody(body, requestFormat);
+    } catch (const json::exception&) {
+    }
+    if (!request.is_object()) {
+        response.status = 400;
+        response.body = R"({"success":false,"message":"Invalid request body"})";
+        return response;
+    }
+
+    try {
+        json result;
+        if (route == API_VALIDATE_PATH) {
+            result = Validate(request);
+        } else if (route == API_CHECK_SESSION_PATH) {
+            result = CheckSession(request);
+        } else if (route == API_CHECK_SESSION_BATCH_PATH) {
+            result = CheckSessionBatch(request);
+        } else {
+            result = Logout(request);
+        }
+        response.format = NegotiateWireFormat(accept);
+        response.body = EncodeBody(result, response.format);
+    } catch (const json::exception&) {
+        response.status = 400;
+        response.body = R"({"success":false,"message":"Malformed request"})";
+    }
+
+    return response;
+}
+
+json AuthService::Validate(const json& request) {
+    std::string username = request.at("username").get<std::string>();
+    std::string keyHash = request.at("key").get<std::string>();
+    std::string hwid = request.value("hwid", std::string());
+    std::time_t now = std::time(nullptr);
+
+    json result;
+    result["success"] = false;
+
+    if (username.empty() || keyHash.empty()) {
+        result["message"] = "Username and key are required";
+        return result;
+    }
+
+    Digest userDigest = Digest::Hash(username);
+    if (!config.acceptAny) {
+        switch (store.ClaimLicense(Digest::FromValue(keyHash), userDigest, Digest::FromValue(hwid), now)) {
+        case LicenseStatus::Ok:
+            break;
+        case LicenseStatus::NotFound:
+            result["message"] = "Invalid key";
+            return result;
+        case LicenseStatus::Expired:
+            result["message"] = "Key expired";
+            return result;
+        case LicenseStatus::HwidMismatch:
+            result["message"] = "Key is bound to another device";
+            return result;
+        }
+    }
+
+    std::string token = NewSessionToken();
+    SessionRecord session;
+    session.key = Digest::FromValue(token);
+    session.username = userDigest;
+    session.hwid = Digest::FromValue(hwid);
+    session.expiresAt = now + config.sessionTtl;
+    store.PutSession(session);
+
+    result["success"] = true;
+    result["session_token"] = token;
+    result["expires_at"] = static_cast<std::time_t>(session.expiresAt);
+    result["message"] = "Login successful";
+    SignSession(result, username, hwid, session.expiresAt, token);
+    return result;
+}
+
+void AuthService::SignSession(json& result, const std::string& username, const std::string& hwid,
+                              std::time_t expiresAt, const std::string& token) const {
+    if (!signer.IsLoaded()) {
+        return;
+    }
+    std::string signature = signer.Sign(SessionSignatureMessage(username, hwid, expiresAt, token));
+    if (!signature.empty()) {
+        result["signature"] = signature;
+    }
+}
+
+bool AuthService::IsSessionValid(const json& request, std::time_t& expiresAt) {
+    Digest hwid;
+    if (!store.FindSession(Digest::FromValue(request.at("session_token").get<std::string>()),
+                           Digest::Hash(request.value("username", std::string())),
+                           std::time(nullptr), expiresAt, hwid)) {
+        return false;
+    }
+    // A token presented from another device is not that device's session.
+    return !request.contains("hwid") || Digest::FromValue(request.at("hwid").get<std::string>()) == hwid;
+}
+
+json AuthService::CheckSession(const json& request) {
+    std::time_t expiresAt = 0;
+    json result;
+    result["valid"] = IsSessionValid(request, expiresAt);
+    if (result["valid"].get<bool>()) {
+        result["expires_at"] = expiresAt;
+        // Only clients that send their hardware ID can check the signature,
+        // and IsSessionValid() has matched it against the one at login.
+        if (request.contains("hwid")) {
+            SignSession(result, request.value("username", std::string()), request.at("hwid").get<std::string>(),
+                        expiresAt, request.at("session_token").get<std::string>());
+        }
+    }
+    return result;
+}
+
+json AuthService::CheckSessionBatch(const json& request) {
+    const json& sessions = request.at("sessions");
+    json results = json::array();
+
+    for (const json& entry : sessions) {
+        std::time_t expiresAt = 0;
+        bool valid = IsSessionValid(entry, expiresAt);
+        json item;
+        item["valid"] = valid;
+        if (valid) {
+            item["expires_at"] = expiresAt;
+        }
+        results.push_back(std::move(item));
+    }
+
+    json result;
+    result["results"] = std::move(results);
+    return result;
+}
+
+json AuthService::Logout(const json& request) {
+    std::string token = request.at("session_token").get<std::string>();
+    std::string username = request.value("username", std::string());
+    store.EraseSession(Digest::FromValue(token), Digest::Hash(username));
+
+    json result;
+    result["success"] = true;
+    return result;
+}
@@ -0,0 +1,790 @@
+#include "auth_store.h"
+#include "hex.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/sha.h>
+
+static_assert(sizeof(Digest) == 32, "Digest must be 32 bytes");
+static_assert(sizeof(LicenseRecord) == 104, "LicenseRecord layout changed");
+static_assert(sizeof(SessionRecord) == 104, "SessionRecord layout changed");
+static_assert(std::is_trivially_copyable<LicenseRecord>::value, "LicenseRecord must be trivially copyable");
+static_assert(std::is_trivially_copyable<SessionRecord>::value, "SessionRecord must be trivially copyable");
+
+namespace {
+
+const char SNAPSHOT_MAGIC[4] = {'L', 'S', 'T', '1'};
+const uint32_t SNAPSHOT_VERSION = 2;
+// Version 1 sessions had no hardware ID. Their licenses still load; the
+// sessions are dropped and those users log in again.
+const uint32_t SNAPSHOT_VERSION_NO_SESSION_HWID = 1;
+const size_t SESSION_RECORD_NO_HWID_SIZE = 72;
+
+enum LogRecordType : uint32_t {
+    LOG_LICENSE = 1,
+    LOG_SESSION_NO_HWID = 2,  // written by older servers; skipped on replay
+    LOG_SESSION_ERASE = 3,
+    LOG_SESSION = 4
+};
+
+struct LogFrame {
+    uint32_t type;
+    uint32_t checksum;
+};
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t shardCount;
+    uint64_t logGeneration;
+    uint64_t licenseCount;
+    uint64_t sessionCount;
+};
+
+uint32_t Checksum(uint32_t type, const void* data, size_t length) {
+    // FNV-1a; only has to catch a torn or garbled tail record.
+    uint32_t hash = 2166136261u ^ type;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+size_t RecordLength(uint32_t type) {
+    switch (type) {
+    case LOG_LICENSE: return sizeof(LicenseRecord);
+    case LOG_SESSION: return sizeof(SessionRecord);
+    case LOG_SESSION_NO_HWID: return SESSION_RECORD_NO_HWID_SIZE;
+    case LOG_SESSION_ERASE: return sizeof(Digest);
+    default: return 0;
+    }
+}
+
+bool WriteAll(int fd, const void* data, size_t length) {
+    const char* cursor = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t written = write(fd, cursor, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        cursor += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Linear-probing table keyed by the record's leading digest. States live in
+// their own array so probing touches one byte per slot.
+template <typename Record>
+class DigestTable {
+private:
+    enum : uint8_t { EMPTY = 0, USED = 1, DELETED = 2 };
+
+    std::vector<Record> slots;
+    std::vector<uint8_t> states;
+    size_t count = 0;
+    size_t tombstones = 0;
+
+    static uint64_t HashOf(const Digest& key) {
+        uint64_t hash;
+        std::memcpy(&hash, key.bytes, sizeof(hash));
+        return hash;
+    }
+
+    void Rehash(size_t capacity) {
+        std::vector<Record> oldSlots;
+        std::vector<uint8_t> oldStates;
+        oldSlots.swap(slots);
+        oldStates.swap(states);
+
+        slots.resize(capacity);
+        states.assign(capacity, EMPTY);
+        count = 0;
+        tombstones = 0;
+
+        for (size_t i = 0; i < oldStates.size(); i++) {
+            if (oldStates[i] == USED) {
+                bool inserted;
+                Insert(oldSlots[i].key, inserted) = oldSlots[i];
+            }
+        }
+    }
+
+    static size_t CapacityFor(size_t expected) {
+        size_t capacity = 16;
+        while (capacity * 7 / 10 < expected) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+public:
+    void Reserve(size_t expected) {
+        size_t capacity = CapacityFor(expected);
+        if (capacity > states.size()) {
+            Rehash(capacity);
+        }
+    }
+
+    Record* Find(const Digest& key) {
+        if (states.empty()) {
+            return nullptr;
+        }
+        size_t mask = states.size() - 1;
+        for (size_t i = HashOf(key) & mask;; i = (i + 1) & mask) {
+            if (states[i] == EMPTY) {
+                return nullptr;
+            }
+            if (states[i] == USED && slots[i].key == key) {
+                return &slots[i];
+            }
+        }
+    }
+
+    Record& Insert(const Digest& key, bool& inserted) {
+        if ((count + tombstones + 1) * 10 > states.size() * 7) {
+            // Also runs at the same size when tombstones are the problem.
+            Rehash(CapacityFor((count + 1) * 2));
+        }
+
+        size_t mask = states.size() - 1;
+        size_t target = states.size();
+        for (size_t i = HashOf(key) & mask;; i = (i + 1) & mask) {
+            if (states[i] == USED) {
+                if (slots[i].key == key) {
+                    inserted = false;
+                    return slots[i];
+                }
+            } else {
+                if (target == states.size()) {
+                    target = i;
+                }
+                if (states[i] == EMPTY) {
+                    break;
+                }
+            }
+        }
+
+        if (states[target] == DELETED) {
+            tombstones--;
+        }
+        states[target] = USED;
+        slots[target].key = key;
+        count++;
+        inserted = true;
+        return slots[target];
+    }
+
+    bool Erase(const Digest& key) {
+        Record* record = Find(key);
+        if (!record) {
+            return false;
+        }
+        states[record - slots.data()] = DELETED;
+        count--;
+        tombstones++;
+        return true;
+    }
+
+    template <typename Predicate>
+    size_t EraseIf(Predicate predicate) {
+        size_t erased = 0;
+        for (size_t i = 0; i < states.size(); i++) {
+            if (states[i] == USED && predicate(slots[i])) {
+                states[i] = DELETED;
+                erased++;
+            }
+        }
+        count -= erased;
+        tombstones += erased;
+        return erased;
+    }
+
+    template <typename Visitor>
+    void ForEach(Visitor visit) const {
+        for (size_t i = 0; i < states.size(); i++) {
+            if (states[i] == USED) {
+                visit(slots[i]);
+            }
+        }
+    }
+
+    size_t Size() const { return count; }
+};
+
+}
+
+const size_t AuthStore::SHARD_COUNT;
+
+struct AuthStore::LicenseShard {
+    std::mutex mutex;
+    DigestTable<LicenseRecord> table;
+};
+
+struct AuthStore::SessionShard {
+    std::mutex mutex;
+    DigestTable<SessionRecord> table;
+};
+
+bool Digest::operator==(const Digest& other) const {
+    return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+bool Digest::IsZero() const {
+    for (uint8_t byte : bytes) {
+        if (byte != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Digest Digest::FromValue(const std::string& value) {
+    Digest digest;
+    if (HexDecode(value, digest.bytes, sizeof(digest.bytes))) {
+        return digest;
+    }
+    return Hash(value);
+}
+
+Digest Digest::Hash(const std::string& value) {
+    Digest digest;
+    SHA256(reinterpret_cast<const unsigned char*>(value.data()), value.size(), digest.bytes);
+    return digest;
+}
+
+std::string Digest::ToHex() const {
+    return HexEncode(bytes, sizeof(bytes));
+}
+
+AuthStore::AuthStore()
+    : licenseShards(new LicenseShard[SHARD_COUNT]),
+      sessionShards(new SessionShard[SHARD_COUNT]),
+      logFd(-1),
+      logGeneration(0) {
+}
+
+AuthStore::~AuthStore() {
+    if (logFd >= 0) {
+        fdatasync(logFd);
+        close(logFd);
+    }
+}
+
+size_t AuthStore::ShardFor(const Digest& key) {
+    // Probe positions use the leading bytes; take the shard from elsewhere so
+    // the two stay independent.
+    return key.bytes[8] % SHARD_COUNT;
+}
+
+std::string AuthStore::LogPath(uint64_t generation) const {
+    return dataDir + "/log." + std::to_string(generation);
+}
+
+std::string AuthStore::SnapshotPath() const {
+    return dataDir + "/snapshot.bin";
+}
+
+bool AuthStore::Open(const std::string& directory, std::string& error) {
+    if (directory.empty()) {
+        return true;
+    }
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        error = "cannot create " + directory + ": " + std::strerror(errno);
+        return false;
+    }
+    dataDir = directory;
+
+    if (!LoadSnapshot(error)) {
+        return false;
+    }
+
+    // Replay every log the snapshot does not cover, then keep appending to
+    // the newest one.
+    uint64_t generation = logGeneration;
+    while (true) {
+        bool found = false;
+        if (!ReplayLog(generation, found, error)) {
+            return false;
+        }
+        if (!found) {
+            break;
+        }
+        logGeneration = generation++;
+    }
+
+    return OpenLog(error);
+}
+
+bool AuthStore::LoadSnapshot(std::string& error) {
+    int fd = open(SnapshotPath().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        error = "cannot open " + SnapshotPath() + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+        close(fd);
+        error = SnapshotPath() + " is truncated";
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "cannot map " + SnapshotPath() + ": " + std::strerror(errno);
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    const char* base = static_cast<const char*>(mapped);
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    size_t countsOffset = sizeof(SnapshotHeader);
+    size_t recordsOffset = countsOffset + 2 * SHARD_COUNT * sizeof(uint64_t);
+    bool loadSessions = header.version == SNAPSHOT_VERSION;
+    size_t sessionSize = loadSessions ? sizeof(SessionRecord) : SESSION_RECORD_NO_HWID_SIZE;
+    bool valid = std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+                 (header.version == SNAPSHOT_VERSION || header.version == SNAPSHOT_VERSION_NO_SESSION_HWID) &&
+                 header.shardCount == SHARD_COUNT &&
+                 size == recordsOffset + header.licenseCount * sizeof(LicenseRecord) +
+                         header.sessionCount * sessionSize;
+    if (!valid) {
+        munmap(mapped, size);
+        error = SnapshotPath() + " is corrupt or from another version";
+        return false;
+    }
+
+    uint64_t licenseCounts[SHARD_COUNT];
+    uint64_t sessionCounts[SHARD_COUNT];
+    std::memcpy(licenseCounts, base + countsOffset, sizeof(licenseCounts));
+    std::memcpy(sessionCounts, base + countsOffset + sizeof(licenseCounts), sizeof(sessionCounts));
+
+    // Records are grouped by shard, so each shard can be filled independently.
+    size_t licenseOffsets[SHARD_COUNT];
+    size_t sessionOffsets[SHARD_COUNT];
+    size_t licenseCursor = recordsOffset;
+    size_t sessionCursor = recordsOffset + header.licenseCount * sizeof(LicenseRecord);
+    for (size_t shard = 0; shard < SHARD_COUNT; shard++) {
+        licenseOffsets[shard] = licenseCursor;
+        sessionOffsets[shard] = sessionCursor;
+        licenseCursor += licenseCounts[shard] * sizeof(LicenseRecord);
+        sessionCursor += sessionCounts[shard] * sessionSize;
+    }
+
+    std::time_t now = std::time(nullptr);
+    auto loadShards = [&](size_t first, size_t stride) {
+        for (size_t shard = first; shard < SHARD_COUNT; shard += stride) {
+            LicenseShard& licenses = licenseShards[shard];
+            licenses.table.Reserve(licenseCounts[shard]);
+            for (uint64_t i = 0; i < licenseCounts[shard]; i++) {
+                LicenseRecord record;
+                std::memcpy(&record, base + licenseOffsets[shard] + i * sizeof(LicenseRecord), sizeof(record));
+                bool inserted;
+                licenses.table.Insert(record.key, inserted) = record;
+            }
+
+            if (!loadSessions) {
+                continue;
+            }
+            SessionShard& sessions = sessionShards[shard];
+            sessions.table.Reserve(sessionCounts[shard]);
+            for (uint64_t i = 0; i < sessionCounts[shard]; i++) {
+                SessionRecord record;
+                std::memcpy(&record, base + sessionOffsets[shard] + i * sizeof(SessionRecord), sizeof(record));
+                if (record.expiresAt > now) {
+                    bool inserted;
+                    sessions.table.Insert(record.key, inserted) = record;
+                }
+            }
+        }
+    };
+
+    size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), SHARD_COUNT);
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; w++) {
+        threads.emplace_back(loadShards, w, workers);
+    }
+    loadShards(0, workers);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    munmap(mapped, size);
+    logGeneration = header.logGeneration;
+    return true;
+}
+
+bool AuthStore::ReplayLog(uint64_t generation, bool& found, std::string& error) {
+    std::string path = LogPath(generation);
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        found = false;
+        if (errno == ENOENT) {
+            return true;
+        }
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    found = true;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        error = "cannot stat " + path + ": " + std::strerror(errno);
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        error = "cannot map " + path + ": " + std::strerror(errno);
+        close(fd);
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+
+    const char* base = static_cast<const char*>(mapped);
+    size_t offset = 0;
+    while (offset + sizeof(LogFrame) <= size) {
+        LogFrame frame;
+        std::memcpy(&frame, base + offset, sizeof(frame));
+        size_t length = RecordLength(frame.type);
+        const char* payload = base + offset + sizeof(frame);
+        if (length == 0 || offset + sizeof(frame) + length > size ||
+            Checksum(frame.type, payload, length) != frame.checksum) {
+            break;
+        }
+
+        if (frame.type == LOG_LICENSE) {
+            LicenseRecord record;
+            std::memcpy(&record, payload, sizeof(record));
+            ApplyLicense(record);
+        } else if (frame.type == LOG_SESSION) {
+            SessionRecord record;
+            std::memcpy(&record, payload, sizeof(record));
+            ApplySession(record);
+        } else if (frame.type == LOG_SESSION_ERASE) {
+            Digest token;
+            std::memcpy(&token, payload, sizeof(token));
+            ApplySessionErase(token);
+        }
+        offset += sizeof(frame) + length;
+    }
+
+    munmap(mapped, size);
+    if (offset < size) {
+        // A crash mid-append leaves a partial record; drop it so new records
+        // are not written after garbage.
+        if (ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+            error = "cannot truncate " + path + ": " + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+    }
+    close(fd);
+    return true;
+}
+
+bool AuthStore::OpenLog(std::string& error) {
+    std::string path = LogPath(logGeneration);
+    logFd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (logFd < 0) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void AuthStore::AppendLog(uint32_t type, const void* record, size_t length) {
+    if (dataDir.empty()) {
+        return;
+    }
+
+    // One write() per record: O_APPEND keeps concurrent frames whole.
+    char buffer[sizeof(LogFrame) + sizeof(LicenseRecord)];
+    LogFrame frame;
+    frame.type = type;
+    frame.checksum = Checksum(type, record, length);
+    std::memcpy(buffer, &frame, sizeof(frame));
+    std::memcpy(buffer + sizeof(frame), record, length);
+
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (logFd >= 0) {
+        WriteAll(logFd, buffer, sizeof(frame) + length);
+    }
+}
+
+void AuthStore::ApplyLicense(const LicenseRecord& record) {
+    LicenseShard& shard = licenseShards[ShardFor(record.key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bool inserted;
+    shard.table.Insert(record.key, inserted) = record;
+}
+
+void AuthStore::ApplySession(const SessionRecord& record) {
+    SessionShard& shard = sessionShards[ShardFor(record.key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bool inserted;
+    shard.table.Insert(record.key, inserted) = record;
+}
+
+void AuthStore::ApplySessionErase(const Digest& token) {
+    SessionShard& shard = sessionShards[ShardFor(token)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.table.Erase(token);
+}
+
+bool AuthStore::UpsertLicense(const Digest& key, const Digest& username, std::time_t expiresAt) {
+    LicenseShard& shard = licenseShards[ShardFor(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    bool inserted;
+    LicenseRecord& record = shard.table.Insert(key, inserted);
+    if (!inserted && record.username == username && record.expiresAt == expiresAt) {
+        return false;
+    }
+    if (inserted || record.username != username) {
+        std::memset(&record.hwid, 0, sizeof(record.hwid));
+    }
+    record.username = username;
+    record.expiresAt = expiresAt;
+
+    // Logged under the shard lock so the log orders writes to one key the
+    // same way the table saw them.
+    AppendLog(LOG_LICENSE, &record, sizeof(record));
+    return true;
+}
+
+LicenseStatus AuthStore::ClaimLicense(const Digest& key, const Digest& username, const Digest& hwid, std::time_t now) {
+    LicenseShard& shard = licenseShards[ShardFor(key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    LicenseRecord* record = shard.table.Find(key);
+    if (!record || record->username != username) {
+        return LicenseStatus::NotFound;
+    }
+    if (record->expiresAt != 0 && record->expiresAt <= now) {
+        return LicenseStatus::Expired;
+    }
+    if (record->hwid.IsZero()) {
+        record->hwid = hwid;
+        AppendLog(LOG_LICENSE, record, sizeof(*record));
+    } else if (record->hwid != hwid) {
+        return LicenseStatus::HwidMismatch;
+    }
+    return LicenseStatus::Ok;
+}
+
+void AuthStore::PutSession(const SessionRecord& session) {
+    SessionShard& shard = sessionShards[ShardFor(session.key)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    bool inserted;
+    shard.table.Insert(session.key, inserted) = session;
+    AppendLog(LOG_SESSION, &session, sizeof(session));
+}
+
+bool AuthStore::FindSession(const Digest& token, const Digest& username, std::time_t now,
+                            std::time_t& expiresAt, Digest& hwid) {
+    SessionShard& shard = sessionShards[ShardFor(token)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    SessionRecord* record = shard.table.Find(token);
+    if (!record) {
+        return false;
+    }
+    if (record->expiresAt <= now) {
+        // Expiry is implied by the record itself; no log entry needed.
+        shard.table.Erase(token);
+        return false;
+    }
+    if (record->username != username) {
+        return false;
+    }
+    expiresAt = record->expiresAt;
+    hwid = record->hwid;
+    return true;
+}
+
+void AuthStore::EraseSession(const Digest& token, const Digest& username) {
+    SessionShard& shard = sessionShards[ShardFor(token)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    SessionRecord* record = shard.table.Find(token);
+    if (record && record->username == username) {
+        shard.table.Erase(token);
+        AppendLog(LOG_SESSION_ERASE, &token, sizeof(token));
+    }
+}
+
+size_t AuthStore::PurgeExpiredSessions(std::time_t now) {
+    size_t purged = 0;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        SessionShard& shard = sessionShards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        purged += shard.table.EraseIf([now](const SessionRecord& record) {
+            return record.expiresAt <= now;
+        });
+    }
+    return purged;
+}
+
+size_t AuthStore::LicenseCount() {
+    size_t count = 0;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        std::lock_guard<std::mutex> lock(licenseShards[i].mutex);
+        count += licenseShards[i].table.Size();
+    }
+    return count;
+}
+
+size_t AuthStore::SessionCount() {
+    size_t count = 0;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        std::lock_guard<std::mutex> lock(sessionShards[i].mutex);
+        count += sessionShards[i].table.Size();
+    }
+    return count;
+}
+
+bool AuthStore::Snapshot(std::string& error) {
+    if (dataDir.empty()) {
+        return true;
+    }
+
+    // Rotate first. Every record in the old logs was applied to its table
+    // before being logged, so the copy below captures all of it and those
+    // logs can go once the snapshot is in place.
+    uint64_t snapshotGeneration;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        int newFd = open(LogPath(logGeneration + 1).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+        if (newFd < 0) {
+            error = "cannot open " + LogPath(logGeneration + 1) + ": " + std::strerror(errno);
+            return false;
+        }
+        fdatasync(logFd);
+        close(logFd);
+        logFd = newFd;
+        snapshotGeneration = ++logGeneration;
+    }
+
+    std::string tmpPath = SnapshotPath() + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        error = "cannot create " + tmpPath + ": " + std::strerror(errno);
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.shardCount = SHARD_COUNT;
+    header.logGeneration = snapshotGeneration;
+    header.licenseCount = 0;
+    header.sessionCount = 0;
+    uint64_t licenseCounts[SHARD_COUNT] = {};
+    uint64_t sessionCounts[SHARD_COUNT] = {};
+
+    // Reserve the header and count tables; they are filled in at the end.
+    size_t prefixLength = sizeof(header) + sizeof(licenseCounts) + sizeof(sessionCounts);
+    bool ok = lseek(fd, static_cast<off_t>(prefixLength), SEEK_SET) >= 0;
+
+    // Copy each shard under its lock and write outside it, so a snapshot
+    // only ever blocks one shard at a time.
+    std::vector<LicenseRecord> licenses;
+    for (size_t i = 0; i < SHARD_COUNT && ok; i++) {
+        licenses.clear();
+        {
+            std::lock_guard<std::mutex> lock(licenseShards[i].mutex);
+            licenses.reserve(licenseShards[i].table.Size());
+            licenseShards[i].table.ForEach([&](const LicenseRecord& record) {
+                licenses.push_back(record);
+            });
+        }
+        licenseCounts[i] = licenses.size();
+        header.licenseCount += licenses.size();
+        ok = WriteAll(fd, licenses.data(), licenses.size() * sizeof(LicenseRecord));
+    }
+
+    std::time_t now = std::time(nullptr);
+    std::vector<SessionRecord> sessions;
+    for (size_t i = 0; i < SHARD_COUNT && ok; i++) {
+        sessions.clear();
+        {
+            std::lock_guard<std::mutex> lock(sessionShards[i].mutex);
+            sessions.reserve(sessionShards[i].table.Size());
+            sessionShards[i].table.ForEach([&](const SessionRecord& record) {
+                if (record.expiresAt > now) {
+                    sessions.push_back(record);
+                }
+            });
+        }
+        sessionCounts[i] = sessions.size();
+        header.sessionCount += sessions.size();
+        ok = WriteAll(fd, sessions.data(), sessions.size() * sizeof(SessionRecord));
+    }
+
+    ok = ok &&
+         pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+         pwrite(fd, licenseCounts, sizeof(licenseCounts), sizeof(header)) == static_cast<ssize_t>(sizeof(licenseCounts)) &&
+         pwrite(fd, sessionCounts, sizeof(sessionCounts), sizeof(header) + sizeof(licenseCounts)) ==
+             static_cast<ssize_t>(sizeof(sessionCounts)) &&
+         fsync(fd) == 0;
+    close(fd);
+
+    if (!ok || rename(tmpPath.c_str(), SnapshotPath().c_str()) != 0) {
+        error = "cannot write " + SnapshotPath() + ": " + std::strerror(errno);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    int dirFd = open(dataDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+
+    // Logs from failed earlier snapshots may linger below the previous
+    // generation; walk down until one is missing.
+    for (uint64_t generation = snapshotGeneration; generation-- > 0;) {
+        if (unlink(LogPath(generation).c_str()) != 0 && errno == ENOENT) {
+            break;
+        }
+    }
+    return true;
+}
+
+void AuthStore::Sync() {
+    int fd;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        fd = logFd;
+    }
+    // Outside the lock so appends are not stalled behind the disk. Only
+    // Snapshot() replaces the descriptor, and it runs on the same thread.
+    if (fd >= 0) {
+        fdatasync(fd);
+    }
+}
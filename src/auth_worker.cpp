@@ -0,0 +1,186 @@
+#include "auth_worker.h"
+#include "config.h"
+
+AuthWorker::AuthWorker(std::function<void()> onCompletionCallback)
+    : AuthWorker(API_BASE_URL, std::move(onCompletionCallback)) {
+}
+
+AuthWorker::AuthWorker(const std::string& apiBaseUrl, std::function<void()> onCompletionCallback)
+    : handler(apiBaseUrl),
+      onCompletion(std::move(onCompletionCallback)),
+      heartbeatId(0),
+      nextTaskId(1),
+      shutdownToken(CancellationToken::Create()),
+      sleeping(false),
+      stopping(false) {
+    workerThread = std::thread(&AuthWorker::Run, this);
+}
+
+AuthWorker::~AuthWorker() {
+    Shutdown();
+}
+
+void AuthWorker::Shutdown() {
+    stopping.store(true);
+    shutdownToken.Cancel();
+    heartbeat.Stop();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+    if (workerThread.joinable()) {
+        workerThread.join();
+    }
+}
+
+uint64_t AuthWorker::Post(AuthTask task) {
+    uint64_t id = nextTaskId.fetch_add(1);
+    task.id = id;
+    tasks.Push(std::move(task));
+
+    // The worker sets `sleeping` before its last look at the queue, so either
+    // it sees this task or we see it asleep and wake it. The lock is only
+    // taken in the second case. Push publishes with a release store, which
+    // may otherwise be reordered after the load of `sleeping`; the fence
+    // pairs with the one in Run() so at least one side sees the other.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+    return id;
+}
+
+uint64_t AuthWorker::Login(const std::string& username, const std::string& key) {
+    AuthTask task;
+    task.type = AuthTaskType::Login;
+    task.username = username;
+    task.key = key;
+    return Post(std::move(task));
+}
+
+uint64_t AuthWorker::CheckSession() {
+    AuthTask task;
+    task.type = AuthTaskType::CheckSession;
+    return Post(std::move(task));
+}
+
+uint64_t AuthWorker::Logout() {
+    AuthTask task;
+    task.type = AuthTaskType::Logout;
+    return Post(std::move(task));
+}
+
+uint64_t AuthWorker::Resume() {
+    AuthTask task;
+    task.type = AuthTaskType::Resume;
+    return Post(std::move(task));
+}
+
+uint64_t AuthWorker::Preconnect() {
+    AuthTask task;
+    task.type = AuthTaskType::Preconnect;
+    task.timeout = std::chrono::milliseconds(PRECONNECT_TIMEOUT_MS);
+    return Post(std::move(task));
+}
+
+bool AuthWorker::PollCompletion(AuthCompletion& completion) {
+    return completions.TryPop(completion);
+}
+
+HeartbeatStats AuthWorker::GetHeartbeatStats() {
+    return heartbeat.GetStats();
+}
+
+void AuthWorker::Run() {
+    AuthTask task;
+    while (!stopping.load()) {
+        if (tasks.TryPop(task)) {
+            Complete(Execute(task));
+            continue;
+        }
+
+        sleeping.store(true);
+        // Orders the store above before the queue check; see Post().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping.load() || !tasks.Empty(); });
+        }
+        sleeping.store(false);
+    }
+}
+
+AuthCompletion AuthWorker::Execute(const AuthTask& task) {
+    AuthCompletion completion;
+    completion.type = task.type;
+    completion.id = task.id;
+
+    OperationContext context(shutdownToken);
+    if (task.timeout.count() > 0) {
+        context = OperationContext::WithTimeout(task.timeout, shutdownToken);
+    }
+
+    switch (task.type) {
+        case AuthTaskType::Login: {
+            StopHeartbeat();
+            AuthResult result = handler.ValidateKey(task.username, task.key, context);
+            completion.success = result.success;
+            completion.message = result.message;
+            if (result.success) {
+                completion.username = handler.GetUsername();
+                StartHeartbeat();
+            }
+            break;
+        }
+        case AuthTaskType::CheckSession:
+            completion.success = handler.CheckSession(context);
+            if (!completion.success && !handler.IsAuthenticated()) {
+                StopHeartbeat();
+            }
+            break;
+        case AuthTaskType::Logout:
+            StopHeartbeat();
+            handler.Logout(context);
+            completion.success = true;
+            break;
+        case AuthTaskType::Resume:
+            completion.success = handler.ResumeSession(context);
+            if (completion.success) {
+                completion.username = handler.GetUsername();
+                StartHeartbeat();
+            }
+            break;
+        case AuthTaskType::Preconnect:
+            completion.success = handler.Preconnect(context);
+            break;
+        case AuthTaskType::SessionLost:
+            break;
+    }
+
+    completion.cancelled = shutdownToken.IsCancelled();
+    return completion;
+}
+
+void AuthWorker::StartHeartbeat() {
+    heartbeatId = heartbeat.Add(handler, [this]() {
+        AuthCompletion lost;
+        lost.type = AuthTaskType::SessionLost;
+        lost.message = "Session expired. Please log in again.";
+        Complete(std::move(lost));
+    });
+}
+
+void AuthWorker::StopHeartbeat() {
+    if (heartbeatId != 0) {
+        heartbeat.Remove(heartbeatId);
+        heartbeatId = 0;
+    }
+}
+
+void AuthWorker::Complete(AuthCompletion completion) {
+    completions.Push(std::move(completion));
+    if (onCompletion && !stopping.load()) {
+        onCompletion();
+    }
+}
@@ -0,0 +1,737 @@
+#include "auth_handler.h"
+#include "config.h"
+#include "http_metrics.h"
+#include "inflight_window.h"
+#include "session_manager.h"
+#include "wire_format.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// End-to-end load and latency benchmark for the auth client. Each worker
+// owns an AuthHandler and loops ValidateKey -> CheckSession -> Logout
+// against a local stand-in server. With --rate the workers follow an open-loop
+// schedule and latency is measured from each operation's intended start
+// time, so a stalled server shows up in the tail instead of being hidden
+// by coordinated omission.
+//
+// --codec skips the server and instead measures what each body encoding costs
+// per endpoint: bytes on the wire and time to encode and decode.
+//
+// --sessions logs in that many users, loads their sessions into a
+// SessionManager and times RefreshAll() at each size, once through the batch
+// route and once through individual pipelined checks.
+
+using Clock = std::chrono::steady_clock;
+
+// operator new calls made on the current thread, so each operation's heap
+// allocations can be reported. libcurl and OpenSSL allocate with malloc and
+// are not counted, nor is work the event loop thread does for a worker:
+// session checks, HTTP/2 and requests with a cancellable context complete
+// there.
+static thread_local unsigned long long threadAllocations = 0;
+
+void* operator new(size_t size) {
+    threadAllocations++;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    threadAllocations++;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+enum BenchOp {
+    OP_VALIDATE = 0,
+    OP_CHECK_SESSION,
+    OP_LOGOUT,
+    OP_COUNT
+};
+
+static const char* OP_NAMES[OP_COUNT] = { "validate", "check-session", "logout" };
+
+struct BenchOptions {
+    std::string baseUrl = BENCH_DEFAULT_BASE_URL;
+    size_t concurrency = 8;
+    double rate = 0.0;
+    double duration = 10.0;
+    double warmup = 1.0;
+    std::string jsonPath;
+    std::string metricsPath;
+    WireFormat wireFormat = WireFormat::Json;
+    HTTPVersion httpVersion = HTTPVersion::Http1;
+    bool codecOnly = false;
+    // Session counts for the --sessions run, ascending.
+    std::vector<size_t> sessionCounts;
+    bool hedge = false;
+    std::vector<std::string> mirrors;
+    // Set by --session-key; otherwise workers use SESSION_SIGNING_PUBLIC_KEY.
+    const SessionVerifier* sessionVerifier = nullptr;
+
+    BenchOptions() {
+        WireFormatFromName(HTTP_WIRE_FORMAT, wireFormat);
+        HTTPVersionFromName(HTTP_VERSION, httpVersion);
+    }
+};
+
+struct OpSamples {
+    std::vector<double> latenciesMs;
+    unsigned long errors = 0;
+    unsigned long long allocations = 0;
+};
+
+struct WorkerResult {
+    OpSamples ops[OP_COUNT];
+    bool hedged = false;
+    HedgeStats hedge = {};
+    unsigned long long localChecks = 0;
+    std::vector<MirrorStats> mirrors;
+};
+
+struct OpSummary {
+    unsigned long count;
+    unsigned long errors;
+    double throughput;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+    double allocationsPerOp;
+};
+
+static void PrintUsage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --base-url URL      stand-in server base URL (default: %s)\n"
+        "  -c, --concurrency N concurrent clients (default: 8)\n"
+        "  -r, --rate R        target login cycles per second across all clients,\n"
+        "                      0 runs closed-loop as fast as possible (default: 0)\n"
+        "  -d, --duration S    measured duration in seconds (default: 10)\n"
+        "  -w, --warmup S      unmeasured warm-up in seconds (default: 1)\n"
+        "      --wire-format F body encoding to negotiate: json, cbor or msgpack\n"
+        "                      (default: %s)\n"
+        "      --http V        HTTP version: 1.1, 2 or h2c (default: %s)\n"
+        "      --hedge         hedge check-session in every other client and compare\n"
+        "                      its p99 with the unhedged clients\n"
+        "      --mirror URL    another base URL serving the same API; repeat for\n"
+        "                      more. Clients pick the fastest healthy one\n"
+        "      --session-key FILE\n"
+        "                      Ed25519 public key (PEM) for checking session\n"
+        "                      signatures locally (server needs --signing-key)\n"
+        "      --codec         benchmark body encodings per endpoint instead\n"
+        "      --sessions N[,N...]\n"
+        "                      benchmark SessionManager memory and RefreshAll()\n"
+        "                      throughput at each session count instead\n"
+        "      --json FILE     also write the results as JSON to FILE\n"
+        "      --metrics FILE  write per-endpoint request phase histograms to FILE,\n"
+        "                      Prometheus text if it ends in .prom, JSON otherwise\n",
+        program, BENCH_DEFAULT_BASE_URL.c_str(), HTTP_WIRE_FORMAT.c_str(), HTTP_VERSION.c_str());
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    rank = std::min(std::max<size_t>(rank, 1), sorted.size());
+    return sorted[rank - 1];
+}
+
+static void RunWorker(const BenchOptions& options, size_t workerIndex,
+                      Clock::time_point measureStart, Clock::time_point end,
+                      WorkerResult& result) {
+    AuthHandler authHandler(options.baseUrl);
+    authHandler.SetSessionPersistence(false);
+    authHandler.SetWireFormat(options.wireFormat);
+    authHandler.SetHttpVersion(options.httpVersion);
+    // With --hedge every other client hedges; the rest are the control group.
+    result.hedged = options.hedge && workerIndex % 2 == 1;
+    authHandler.SetHedging(result.hedged);
+    if (options.sessionVerifier) {
+        authHandler.SetSessionVerifier(options.sessionVerifier);
+    }
+    if (!options.mirrors.empty()) {
+        authHandler.SetMirrors(options.mirrors);
+    }
+
+    std::string username = "bench-user-" + std::to_string(workerIndex);
+    std::string key = "BENCH-KEY-" + std::to_string(workerIndex);
+
+    // Spread the workers' schedules over one interval so an open-loop run
+    // does not fire every client at the same instant.
+    double intervalSec = options.rate > 0 ? options.concurrency / options.rate : 0.0;
+    auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(intervalSec));
+    Clock::time_point scheduled = Clock::now() + interval * workerIndex / std::max<size_t>(options.concurrency, 1);
+
+    while (true) {
+        if (options.rate > 0) {
+            std::this_thread::sleep_until(scheduled);
+        } else {
+            scheduled = Clock::now();
+        }
+        if (scheduled >= end) {
+            break;
+        }
+        bool measured = scheduled >= measureStart;
+
+        Clock::time_point opStart = scheduled;
+        for (int op = 0; op < OP_COUNT; op++) {
+            unsigned long long allocationsBefore = threadAllocations;
+            bool ok = true;
+            switch (op) {
+            case OP_VALIDATE:
+                ok = authHandler.ValidateKey(username, key).success;
+                break;
+            case OP_CHECK_SESSION:
+                ok = authHandler.CheckSession();
+                break;
+            case OP_LOGOUT:
+                authHandler.Logout();
+                break;
+            }
+
+            Clock::time_point opEnd = Clock::now();
+            unsigned long long allocations = threadAllocations - allocationsBefore;
+            if (measured) {
+                OpSamples& samples = result.ops[op];
+                samples.allocations += allocations;
+                samples.latenciesMs.push_back(std::chrono::duration<double, std::milli>(opEnd - opStart).count());
+                if (!ok) {
+                    samples.errors++;
+                }
+            }
+            opStart = opEnd;
+
+            if (op == OP_VALIDATE && !ok) {
+                break;
+            }
+        }
+
+        scheduled += interval;
+    }
+
+    result.hedge = authHandler.GetHedgeStats();
+    result.localChecks = authHandler.GetLocalSessionChecks();
+    result.mirrors = authHandler.GetMirrorStats();
+}
+
+static double CheckSessionP99(const std::vector<WorkerResult>& results, bool hedged) {
+    std::vector<double> merged;
+    for (const auto& result : results) {
+        if (result.hedged == hedged) {
+            const std::vector<double>& samples = result.ops[OP_CHECK_SESSION].latenciesMs;
+            merged.insert(merged.end(), samples.begin(), samples.end());
+        }
+    }
+    std::sort(merged.begin(), merged.end());
+    return Percentile(merged, 0.99);
+}
+
+// Request and response documents shaped like the real traffic for each
+// endpoint; tokens, key hashes and HWIDs are 64 hex characters.
+struct CodecCase {
+    const char* endpoint;
+    const char* direction;
+    json document;
+};
+
+static std::vector<CodecCase> BuildCodecCases() {
+    const std::string hex64(64, 'a');
+    const std::time_t expiresAt = 1767225600;
+
+    json validateRequest = {
+        { "username", "bench-user-0" }, { "key", hex64 }, { "hwid", hex64 }, { "app_version", APP_VERSION }
+    };
+    json validateResponse = {
+        { "success", true }, { "session_token", hex64 }, { "expires_at", expiresAt }, { "message", "Login successful" }
+    };
+    json sessionRequest = { { "session_token", hex64 }, { "username", "bench-user-0" } };
+    json checkResponse = { { "valid", true }, { "expires_at", expiresAt } };
+
+    json batchRequest;
+    json batchResponse;
+    batchRequest["sessions"] = json::array();
+    batchResponse["results"] = json::array();
+    for (size_t i = 0; i < SESSION_BATCH_SIZE; i++) {
+        batchRequest["sessions"].push_back({ { "session_token", hex64 }, { "username", "bench-user-" + std::to_string(i) } });
+        batchResponse["results"].push_back(checkResponse);
+    }
+
+    return {
+        { "validate", "request", validateRequest },
+        { "validate", "response", validateResponse },
+        { "check-session", "request", sessionRequest },
+        { "check-session", "response", checkResponse },
+        { "check-session/batch", "request", batchRequest },
+        { "check-session/batch", "response", batchResponse },
+        { "logout", "request", sessionRequest },
+        { "logout", "response", { { "success", true } } },
+    };
+}
+
+// Repeats `operation` for at least CODEC_MIN_SECONDS and returns ns per call.
+template <typename Operation>
+static double TimePerCall(Operation operation) {
+    const double CODEC_MIN_SECONDS = 0.1;
+    size_t calls = 0;
+    size_t batch = 16;
+    Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    while (elapsed < CODEC_MIN_SECONDS) {
+        for (size_t i = 0; i < batch; i++) {
+            operation();
+        }
+        calls += batch;
+        batch *= 2;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return elapsed * 1e9 / calls;
+}
+
+static int RunCodecBenchmark(const BenchOptions& options) {
+    const WireFormat formats[] = { WireFormat::Json, WireFormat::Cbor, WireFormat::MsgPack };
+    std::vector<CodecCase> cases = BuildCodecCases();
+    json report = json::array();
+    size_t sink = 0;
+
+    printf("%-20s %-9s %-8s %8s %11s %11s\n", "endpoint", "body", "format", "bytes", "encode ns", "decode ns");
+    for (const CodecCase& codecCase : cases) {
+        for (WireFormat format : formats) {
+            std::string encoded = EncodeBody(codecCase.document, format);
+            double encodeNs = TimePerCall([&]() { sink += EncodeBody(codecCase.document, format).size(); });
+            double decodeNs = TimePerCall([&]() { sink += DecodeBody(encoded, format).size(); });
+
+            printf("%-20s %-9s %-8s %8zu %11.0f %11.0f\n", codecCase.endpoint, codecCase.direction,
+                   WireFormatName(format), encoded.size(), encodeNs, decodeNs);
+            report.push_back({
+                { "endpoint", codecCase.endpoint },
+                { "body", codecCase.direction },
+                { "format", WireFormatName(format) },
+                { "bytes", encoded.size() },
+                { "encode_ns", encodeNs },
+                { "decode_ns", decodeNs }
+            });
+        }
+    }
+    if (sink == 0) {
+        fprintf(stderr, "codec benchmark produced no output\n");
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath, std::ios::trunc);
+        out << json({ { "codec", report } }).dump(2) << '\n';
+        if (!out.good()) {
+            fprintf(stderr, "Failed to write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Logs in `count` distinct users and returns their sessions. The stand-in
+// server needs --accept-any for this.
+static bool IssueSessions(const BenchOptions& options, size_t count, std::vector<std::string>& usernames,
+                          std::vector<std::string>& tokens, std::vector<std::time_t>& expiresAt) {
+    HTTPClient httpClient;
+    httpClient.SetWireFormat(options.wireFormat);
+    std::string endpoint = options.baseUrl + API_VALIDATE_PATH;
+    const std::string hwid(64, 'b');
+
+    usernames.resize(count);
+    tokens.assign(count, std::string());
+    expiresAt.assign(count, 0);
+    std::vector<std::string> keys(count);
+    std::atomic<size_t> failures(0);
+
+    InFlightWindow window(SESSION_PIPELINE_DEPTH);
+    for (size_t i = 0; i < count; i++) {
+        usernames[i] = "session-user-" + std::to_string(i);
+        keys[i] = "SESSION-KEY-" + std::to_string(i);
+        RequestBody body;
+        body.Add("username", usernames[i]).Add("key", keys[i]).Add("hwid", hwid);
+
+        window.Acquire();
+        httpClient.PostAsync(endpoint, body, [&, i](const HTTPResponse& response) {
+            bool success = false;
+            int64_t expires = 0;
+            if (response.success && response.statusCode == 200) {
+                try {
+                    FieldReader reader;
+                    reader.Bool("success", success).String("session_token", tokens[i]).Integer("expires_at", expires);
+                    reader.Read(response.body, response.format);
+                } catch (const json::exception&) {
+                    success = false;
+                }
+            }
+            if (!success || tokens[i].empty()) {
+                failures++;
+            }
+            expiresAt[i] = static_cast<std::time_t>(expires);
+            window.Release();
+        });
+    }
+    window.WaitIdle();
+
+    if (failures > 0) {
+        fprintf(stderr, "%zu of %zu logins failed; is the server running with --accept-any?\n",
+                failures.load(), count);
+        return false;
+    }
+    return true;
+}
+
+static int RunSessionBenchmark(const BenchOptions& options) {
+    size_t largest = options.sessionCounts.back();
+    fprintf(stderr, "issuing %zu sessions from %s\n", largest, options.baseUrl.c_str());
+    std::vector<std::string> usernames;
+    std::vector<std::string> tokens;
+    std::vector<std::time_t> expiresAt;
+    Clock::time_point issueStart = Clock::now();
+    if (!IssueSessions(options, largest, usernames, tokens, expiresAt)) {
+        return 1;
+    }
+    fprintf(stderr, "issued in %.1f s\n", std::chrono::duration<double>(Clock::now() - issueStart).count());
+
+    json report = json::array();
+    printf("%-10s %-10s %14s %10s %12s %10s %8s\n",
+           "sessions", "route", "bytes/session", "requests", "sessions/s", "refresh ms", "failed");
+    for (size_t count : options.sessionCounts) {
+        for (bool batch : { true, false }) {
+            SessionManager manager(options.baseUrl);
+            manager.SetBatchEnabled(batch);
+            manager.Reserve(count, usernames[count - 1].size() + tokens[0].size());
+            for (size_t i = 0; i < count; i++) {
+                manager.Add(usernames[i], tokens[i], expiresAt[i]);
+            }
+            double bytesPerSession = static_cast<double>(manager.MemoryUsage()) / count;
+
+            Clock::time_point refreshStart = Clock::now();
+            SessionRefreshStats stats = manager.RefreshAll();
+            double seconds = std::chrono::duration<double>(Clock::now() - refreshStart).count();
+            double sessionsPerSecond = seconds > 0 ? stats.checked / seconds : 0.0;
+            // A batch run that fell back to single checks is not what was asked for.
+            const char* route = stats.usedBatchEndpoint && manager.IsBatchEnabled() ? "batch" : "pipelined";
+            size_t failed = stats.failed + stats.invalid;
+
+            printf("%-10zu %-10s %14.1f %10zu %12.0f %10.1f %8zu\n",
+                   count, route, bytesPerSession, stats.requests, sessionsPerSecond, seconds * 1000.0, failed);
+            report.push_back({
+                { "sessions", count },
+                { "route", route },
+                { "bytes_per_session", bytesPerSession },
+                { "requests", stats.requests },
+                { "sessions_per_second", sessionsPerSecond },
+                { "refresh_ms", seconds * 1000.0 },
+                { "failed", failed }
+            });
+        }
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath, std::ios::trunc);
+        out << json({ { "sessions", report } }).dump(2) << '\n';
+        if (!out.good()) {
+            fprintf(stderr, "Failed to write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::unique_ptr<SessionVerifier> sessionVerifier;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--base-url" && hasValue) {
+            options.baseUrl = argv[++i];
+        } else if ((arg == "-c" || arg == "--concurrency") && hasValue) {
+            options.concurrency = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if ((arg == "-r" || arg == "--rate") && hasValue) {
+            options.rate = std::atof(argv[++i]);
+        } else if ((arg == "-d" || arg == "--duration") && hasValue) {
+            options.duration = std::atof(argv[++i]);
+        } else if ((arg == "-w" || arg == "--warmup") && hasValue) {
+            options.warmup = std::atof(argv[++i]);
+        } else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            options.metricsPath = argv[++i];
+        } else if (arg == "--wire-format" && hasValue) {
+            if (!WireFormatFromName(argv[++i], options.wireFormat)) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--http" && hasValue) {
+            if (!HTTPVersionFromName(argv[++i], options.httpVersion)) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--hedge") {
+            options.hedge = true;
+        } else if (arg == "--mirror" && hasValue) {
+            options.mirrors.push_back(argv[++i]);
+        } else if (arg == "--session-key" && hasValue) {
+            std::ifstream keyFile(argv[++i]);
+            std::string pem((std::istreambuf_iterator<char>(keyFile)), std::istreambuf_iterator<char>());
+            sessionVerifier.reset(new SessionVerifier(pem));
+            if (!sessionVerifier->IsEnabled()) {
+                fprintf(stderr, "%s is not an Ed25519 public key\n", argv[i]);
+                return 1;
+            }
+            options.sessionVerifier = sessionVerifier.get();
+        } else if (arg == "--codec") {
+            options.codecOnly = true;
+        } else if (arg == "--sessions" && hasValue) {
+            const char* cursor = argv[++i];
+            while (*cursor) {
+                char* next;
+                size_t count = std::strtoul(cursor, &next, 10);
+                if (next == cursor || count == 0 || (*next && *next != ',')) {
+                    PrintUsage(argv[0]);
+                    return 1;
+                }
+                options.sessionCounts.push_back(count);
+                cursor = *next ? next + 1 : next;
+            }
+            std::sort(options.sessionCounts.begin(), options.sessionCounts.end());
+        } else {
+            PrintUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (options.codecOnly) {
+        return RunCodecBenchmark(options);
+    }
+    if (!options.sessionCounts.empty()) {
+        return RunSessionBenchmark(options);
+    }
+
+    char mode[64];
+    if (options.rate > 0) {
+        snprintf(mode, sizeof(mode), "%.1f cycles/s", options.rate);
+    } else {
+        snprintf(mode, sizeof(mode), "closed loop");
+    }
+    fprintf(stderr, "benchmarking %s: %zu clients, %s, HTTP %s, %s bodies, %.1fs warm-up + %.1fs measured\n",
+            options.baseUrl.c_str(), options.concurrency, mode, HTTPVersionName(options.httpVersion),
+            WireFormatName(options.wireFormat), options.warmup, options.duration);
+
+    Clock::time_point start = Clock::now();
+    auto toDuration = [](double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+    Clock::time_point measureStart = start + toDuration(options.warmup);
+    Clock::time_point end = measureStart + toDuration(options.duration);
+
+    std::vector<WorkerResult> results(options.concurrency);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < options.concurrency; i++) {
+        workers.emplace_back(RunWorker, std::cref(options), i, measureStart, end, std::ref(results[i]));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    OpSummary summaries[OP_COUNT];
+    for (int op = 0; op < OP_COUNT; op++) {
+        std::vector<double> merged;
+        unsigned long errors = 0;
+        unsigned long long allocations = 0;
+        for (const auto& result : results) {
+            merged.insert(merged.end(), result.ops[op].latenciesMs.begin(), result.ops[op].latenciesMs.end());
+            errors += result.ops[op].errors;
+            allocations += result.ops[op].allocations;
+        }
+        std::sort(merged.begin(), merged.end());
+
+        OpSummary& summary = summaries[op];
+        summary.count = merged.size();
+        summary.errors = errors;
+        summary.throughput = options.duration > 0 ? merged.size() / options.duration : 0.0;
+        summary.p50 = Percentile(merged, 0.50);
+        summary.p90 = Percentile(merged, 0.90);
+        summary.p99 = Percentile(merged, 0.99);
+        summary.p999 = Percentile(merged, 0.999);
+        summary.max = merged.empty() ? 0.0 : merged.back();
+        summary.allocationsPerOp = merged.empty() ? 0.0 : static_cast<double>(allocations) / merged.size();
+    }
+
+    HTTPConnectionStats connections = HTTPClient::GetConnectionStats();
+
+    printf("%-14s %10s %8s %10s %9s %9s %9s %9s %9s\n",
+           "operation", "count", "errors", "ops/s", "p50 ms", "p90 ms", "p99 ms", "p999 ms", "max ms");
+    for (int op = 0; op < OP_COUNT; op++) {
+        const OpSummary& s = summaries[op];
+        printf("%-14s %10lu %8lu %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+               OP_NAMES[op], s.count, s.errors, s.throughput, s.p50, s.p90, s.p99, s.p999, s.max);
+    }
+    // Only what each worker's own thread allocated; see threadAllocations.
+    printf("allocations per op:");
+    for (int op = 0; op < OP_COUNT; op++) {
+        printf("%s %s %.1f", op > 0 ? "," : "", OP_NAMES[op], summaries[op].allocationsPerOp);
+    }
+    printf("\n");
+    printf("connections: %llu requests (%llu over HTTP/2), %llu reused, %llu opened\n",
+           connections.requests, connections.http2Requests, connections.connectionsReused,
+           connections.connectionsOpened);
+
+    unsigned long long localChecks = 0;
+    for (const auto& result : results) {
+        localChecks += result.localChecks;
+    }
+    if (localChecks > 0) {
+        // Includes the warm-up, unlike the table above.
+        printf("session checks answered locally: %llu\n", localChecks);
+    }
+
+    // Every client keeps its own mirror stats; requests add up and the
+    // latency EWMAs are averaged.
+    json mirrorReport = json::array();
+    for (size_t m = 0; !results.empty() && m < results[0].mirrors.size(); m++) {
+        unsigned long long requests = 0;
+        unsigned long long failures = 0;
+        double latencySum = 0.0;
+        size_t latencyCount = 0;
+        for (const auto& result : results) {
+            const MirrorStats& stats = result.mirrors[m];
+            requests += stats.requests;
+            failures += stats.failures;
+            if (stats.latencyMs >= 0) {
+                latencySum += stats.latencyMs;
+                latencyCount++;
+            }
+        }
+        double latencyMs = latencyCount ? latencySum / latencyCount : -1.0;
+        const std::string& baseUrl = results[0].mirrors[m].baseUrl;
+        printf("mirror %s: %llu requests, %llu failed, latency EWMA %.3f ms\n",
+               baseUrl.c_str(), requests, failures, latencyMs);
+        mirrorReport.push_back({
+            { "base_url", baseUrl },
+            { "requests", requests },
+            { "failures", failures },
+            { "latency_ewma_ms", latencyMs }
+        });
+    }
+
+    HedgeStats hedge = {};
+    double hedgedP99 = 0.0;
+    double controlP99 = 0.0;
+    if (options.hedge) {
+        for (const auto& result : results) {
+            hedge.calls += result.hedge.calls;
+            hedge.hedgesIssued += result.hedge.hedgesIssued;
+            hedge.hedgesWon += result.hedge.hedgesWon;
+            hedge.hedgesDenied += result.hedge.hedgesDenied;
+        }
+        hedgedP99 = CheckSessionP99(results, true);
+        controlP99 = CheckSessionP99(results, false);
+        printf("hedging: %llu checks, %llu hedges (%.1f%%), %llu won, %llu over budget\n",
+               hedge.calls, hedge.hedgesIssued, hedge.calls ? 100.0 * hedge.hedgesIssued / hedge.calls : 0.0,
+               hedge.hedgesWon, hedge.hedgesDenied);
+        printf("check-session p99: %.3f ms hedged, %.3f ms unhedged (%+.1f%%)\n", hedgedP99, controlP99,
+               controlP99 > 0 ? 100.0 * (hedgedP99 - controlP99) / controlP99 : 0.0);
+    }
+
+    // Includes the warm-up, unlike the table above.
+    if (!options.metricsPath.empty() && !HTTPMetrics::Instance().WriteFile(options.metricsPath)) {
+        fprintf(stderr, "Failed to write %s\n", options.metricsPath.c_str());
+        return 1;
+    }
+
+    if (!options.jsonPath.empty()) {
+        json report;
+        report["base_url"] = options.baseUrl;
+        report["concurrency"] = options.concurrency;
+        report["rate"] = options.rate;
+        report["duration_s"] = options.duration;
+        report["warmup_s"] = options.warmup;
+        report["wire_format"] = WireFormatName(options.wireFormat);
+        report["http_version"] = HTTPVersionName(options.httpVersion);
+        for (int op = 0; op < OP_COUNT; op++) {
+            const OpSummary& s = summaries[op];
+            report["operations"][OP_NAMES[op]] = {
+                { "count", s.count },
+                { "errors", s.errors },
+                { "throughput", s.throughput },
+                { "p50_ms", s.p50 },
+                { "p90_ms", s.p90 },
+                { "p99_ms", s.p99 },
+                { "p999_ms", s.p999 },
+                { "max_ms", s.max },
+                { "allocs_per_op", s.allocationsPerOp }
+            };
+        }
+        report["connections"] = {
+            { "requests", connections.requests },
+            { "reused", connections.connectionsReused },
+            { "opened", connections.connectionsOpened },
+            { "http2_requests", connections.http2Requests }
+        };
+        report["local_session_checks"] = localChecks;
+        if (!mirrorReport.empty()) {
+            report["mirrors"] = mirrorReport;
+        }
+        if (options.hedge) {
+            report["hedging"] = {
+                { "checks", hedge.calls },
+                { "hedges", hedge.hedgesIssued },
+                { "hedges_won", hedge.hedgesWon },
+                { "hedges_over_budget", hedge.hedgesDenied },
+                { "check_session_p99_hedged_ms", hedgedP99 },
+                { "check_session_p99_unhedged_ms", controlP99 }
+            };
+        }
+
+        std::ofstream out(options.jsonPath, std::ios::trunc);
+        out << report.dump(2) << '\n';
+        if (!out.good()) {
+            fprintf(stderr, "Failed to write %s\n", options.jsonPath.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
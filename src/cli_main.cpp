@@ -0,0 +1,152 @@
+#include "auth_handler.h"
+#include "config.h"
+#include "inflight_window.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+
+// Headless batch validator. Streams "username key" pairs from a file or
+// stdin, validates them concurrently with a bounded number of requests in
+// flight, and writes one JSON object per input line. Only the lines that
+// are currently in flight are held in memory, so input size does not matter.
+
+static void PrintUsage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -i, --input FILE        read \"username key\" lines from FILE (default: stdin)\n"
+        "  -o, --output FILE       write JSON lines to FILE (default: stdout)\n"
+        "  -j, --concurrency N     maximum validations in flight (default: %zu)\n"
+        "      --base-url URL      API base URL (default: %s)\n"
+        "  -h, --help              show this help\n",
+        program, CLI_DEFAULT_IN_FLIGHT, API_BASE_URL.c_str());
+}
+
+static bool ParseLine(const std::string& line, std::string& username, std::string& key) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line[start] == '#') {
+        return false;
+    }
+
+    size_t split = line.find_first_of(" \t", start);
+    if (split == std::string::npos) {
+        return false;
+    }
+
+    size_t keyStart = line.find_first_not_of(" \t", split);
+    size_t keyEnd = line.find_last_not_of(" \t\r");
+    if (keyStart == std::string::npos || keyEnd < keyStart) {
+        return false;
+    }
+
+    username = line.substr(start, split - start);
+    key = line.substr(keyStart, keyEnd - keyStart + 1);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string inputPath;
+    std::string outputPath;
+    std::string baseUrl = API_BASE_URL;
+    size_t concurrency = CLI_DEFAULT_IN_FLIGHT;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ((arg == "-i" || arg == "--input") && hasValue) {
+            inputPath = argv[++i];
+        } else if ((arg == "-o" || arg == "--output") && hasValue) {
+            outputPath = argv[++i];
+        } else if ((arg == "-j" || arg == "--concurrency") && hasValue) {
+            concurrency = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--base-url" && hasValue) {
+            baseUrl = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            return 0;
+        } else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::ifstream inputFile;
+    if (!inputPath.empty()) {
+        inputFile.open(inputPath);
+        if (!inputFile.is_open()) {
+            fprintf(stderr, "Cannot open input file: %s\n", inputPath.c_str());
+            return 1;
+        }
+    }
+    std::istream& input = inputPath.empty() ? std::cin : inputFile;
+
+    std::ofstream outputFile;
+    if (!outputPath.empty()) {
+        outputFile.open(outputPath, std::ios::trunc);
+        if (!outputFile.is_open()) {
+            fprintf(stderr, "Cannot open output file: %s\n", outputPath.c_str());
+            return 1;
+        }
+    }
+    std::ostream& output = outputPath.empty() ? std::cout : outputFile;
+
+    AuthHandler authHandler(baseUrl);
+    InFlightWindow window(concurrency);
+    std::mutex outputMutex;
+    std::atomic<unsigned long> succeeded{0};
+    std::atomic<unsigned long> failed{0};
+    unsigned long submitted = 0;
+    unsigned long lineNumber = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::string line;
+    std::string username;
+    std::string key;
+    while (std::getline(input, line)) {
+        lineNumber++;
+        if (!ParseLine(line, username, key)) {
+            continue;
+        }
+
+        window.Acquire();
+        submitted++;
+
+        authHandler.ValidateCredentialsAsync(username, key,
+            [&, lineNumber, username](const AuthResult& result) {
+                json record;
+                record["line"] = lineNumber;
+                record["username"] = username;
+                record["success"] = result.success;
+                record["message"] = result.message;
+                if (result.success) {
+                    record["expires_at"] = result.expiresAt;
+                    succeeded++;
+                } else {
+                    failed++;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    output << record.dump() << '\n';
+                }
+                window.Release();
+            });
+    }
+
+    window.WaitIdle();
+    output.flush();
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    fprintf(stderr, "validated %lu pairs: %lu succeeded, %lu failed in %.2fs (%.1f/s)\n",
+            submitted, succeeded.load(), failed.load(), elapsed,
+            elapsed > 0 ? submitted / elapsed : 0.0);
+
+    return output.good() ? 0 : 1;
+}
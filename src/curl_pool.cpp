@@ -0,0 +1,148 @@
+#include "curl_pool.h"
+#include "config.h"
+#include "startup_trace.h"
+
+CurlPool::CurlPool() : share(nullptr) {
+    StartupTrace::Span span("curl/OpenSSL init");
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    share = curl_share_init();
+    if (share) {
+        curl_share_setopt(share, CURLSHOPT_LOCKFUNC, LockCallback);
+        curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, UnlockCallback);
+        curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+}
+
+CurlPool::~CurlPool() {
+    for (CURL* curl : idleHandles) {
+        curl_easy_cleanup(curl);
+    }
+    idleHandles.clear();
+
+    if (share) {
+        curl_share_cleanup(share);
+    }
+
+    curl_global_cleanup();
+}
+
+CurlPool& CurlPool::Instance() {
+    static CurlPool instance;
+    return instance;
+}
+
+void CurlPool::LockCallback(CURL*, curl_lock_data data, curl_lock_access, void* userp) {
+    static_cast<CurlPool*>(userp)->shareLocks[data].lock();
+}
+
+void CurlPool::UnlockCallback(CURL*, curl_lock_data data, void* userp) {
+    static_cast<CurlPool*>(userp)->shareLocks[data].unlock();
+}
+
+CURL* CurlPool::Acquire() {
+    CURL* curl = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!idleHandles.empty()) {
+            curl = idleHandles.back();
+            idleHandles.pop_back();
+        }
+    }
+
+    if (!curl) {
+        curl = curl_easy_init();
+        if (!curl) {
+            return nullptr;
+        }
+    }
+
+    Attach(curl);
+    return curl;
+}
+
+void CurlPool::Release(CURL* curl) {
+    if (!curl) {
+        return;
+    }
+
+    // curl_easy_reset drops options (including the share) but keeps the
+    // handle's live connections and caches, which is the point of pooling.
+    curl_easy_reset(curl);
+
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (idleHandles.size() < HTTP_POOL_MAX_IDLE_HANDLES) {
+        idleHandles.push_back(curl);
+        return;
+    }
+    curl_easy_cleanup(curl);
+}
+
+void CurlPool::Attach(CURL* curl) {
+    if (share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+    curl_easy_setopt(curl, CURLOPT_MAXCONNECTS, HTTP_POOL_MAX_CONNECTIONS);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, HTTP_KEEPALIVE_IDLE);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, HTTP_KEEPALIVE_INTERVAL);
+}
+
+void CurlPool::RecordTransfer(CURL* curl) {
+    long newConnects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnects);
+
+    long version = 0;
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+
+    requests.fetch_add(1, std::memory_order_relaxed);
+    if (version == CURL_HTTP_VERSION_2_0) {
+        http2Requests.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (newConnects > 0) {
+        connectionsOpened.fetch_add(static_cast<unsigned long long>(newConnects), std::memory_order_relaxed);
+    } else {
+        connectionsReused.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (warmConnectUs.load(std::memory_order_relaxed) != 0) {
+        long long warm = warmConnectUs.exchange(0, std::memory_order_relaxed);
+        if (warm > 0 && newConnects == 0) {
+            preconnectSavedUs.fetch_add(static_cast<unsigned long long>(warm), std::memory_order_relaxed);
+        }
+    }
+}
+
+void CurlPool::RecordPreconnect(CURL* curl) {
+    preconnects.fetch_add(1, std::memory_order_relaxed);
+
+    long newConnects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnects);
+    if (newConnects == 0) {
+        // The connection was already warm; an earlier preconnect or request
+        // paid for it.
+        return;
+    }
+
+    // APPCONNECT covers name lookup, TCP and TLS; it stays 0 on plain http.
+    curl_off_t setupUs = 0;
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &setupUs);
+    if (setupUs == 0) {
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &setupUs);
+    }
+    warmConnectUs.store(setupUs > 0 ? static_cast<long long>(setupUs) : 0, std::memory_order_relaxed);
+}
+
+HTTPConnectionStats CurlPool::GetStats() const {
+    HTTPConnectionStats stats;
+    stats.requests = requests.load(std::memory_order_relaxed);
+    stats.connectionsReused = connectionsReused.load(std::memory_order_relaxed);
+    stats.connectionsOpened = connectionsOpened.load(std::memory_order_relaxed);
+    stats.http2Requests = http2Requests.load(std::memory_order_relaxed);
+    stats.preconnects = preconnects.load(std::memory_order_relaxed);
+    stats.preconnectSavedMs = preconnectSavedUs.load(std::memory_order_relaxed) / 1000.0;
+    return stats;
+}
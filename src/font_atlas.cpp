@@ -0,0 +1,259 @@
+#include "font_atlas.h"
+#include "config.h"
+#include "imgui.h"
+#include "imgui_internal.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const char CACHE_MAGIC[4] = {'L', 'F', 'A', '1'};
+
+struct CacheHeader {
+    char magic[4];
+    uint32_t fontCount;
+    uint64_t key;
+    int32_t texWidth;
+    int32_t texHeight;
+    float uvScale[2];
+    float uvWhitePixel[2];
+};
+
+struct CachedFont {
+    float size;
+    float ascent;
+    float descent;
+    uint32_t glyphCount;
+};
+
+struct CachedGlyph {
+    uint32_t codepoint;
+    float advanceX;
+    float x0, y0, x1, y1;
+    float u0, v0, u1, v1;
+};
+
+uint64_t Fnv1a(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool ReadFile(const std::string& path, std::string& contents) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+}
+
+FontAtlasCache::FontAtlasCache() : path(DefaultPath()) {
+}
+
+FontAtlasCache::FontAtlasCache(const std::string& filePath) : path(filePath) {
+}
+
+std::string FontAtlasCache::DefaultPath() {
+#ifdef _WIN32
+    const char* base = std::getenv("APPDATA");
+    std::string dir = base ? base : ".";
+    return dir + "\\" + FONT_ATLAS_CACHE_FILE_NAME;
+#else
+    const char* base = std::getenv("HOME");
+    std::string dir = base ? base : ".";
+    return dir + "/" + FONT_ATLAS_CACHE_FILE_NAME;
+#endif
+}
+
+uint64_t FontAtlasCache::CacheKey(const std::string& fontData, const std::vector<float>& sizes) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = Fnv1a(hash, IMGUI_VERSION, std::strlen(IMGUI_VERSION));
+    hash = Fnv1a(hash, fontData.data(), fontData.size());
+    hash = Fnv1a(hash, sizes.data(), sizes.size() * sizeof(float));
+    return hash;
+}
+
+std::vector<ImFont*> FontAtlasCache::Load(ImFontAtlas* atlas, const std::string& fontFile,
+                                          const std::vector<float>& sizes, FontAtlasStats& stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::string fontData;
+    bool useFile = !fontFile.empty() && ReadFile(fontFile, fontData) && !fontData.empty();
+
+    // Adding a font only registers its data; glyphs are rasterized by the
+    // atlas build, which a cache hit skips entirely.
+    std::vector<ImFont*> fonts;
+    for (float size : sizes) {
+        ImFontConfig config;
+        config.SizePixels = size;
+        if (useFile) {
+            void* data = IM_ALLOC(fontData.size());
+            std::memcpy(data, fontData.data(), fontData.size());
+            fonts.push_back(atlas->AddFontFromMemoryTTF(data, static_cast<int>(fontData.size()), size, &config));
+        } else {
+            fonts.push_back(atlas->AddFontDefault(&config));
+        }
+    }
+
+    uint64_t key = CacheKey(useFile ? fontData : std::string(), sizes);
+    stats.cacheHit = Restore(atlas, key, fonts);
+    if (!stats.cacheHit) {
+        unsigned char* pixels = nullptr;
+        int width = 0;
+        int height = 0;
+        atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+        Save(atlas, key, fonts);
+    }
+
+    stats.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return fonts;
+}
+
+#if IMGUI_VERSION_NUM < 19200
+
+bool FontAtlasCache::Restore(ImFontAtlas* atlas, uint64_t key, const std::vector<ImFont*>& fonts) const {
+    std::string contents;
+    if (!ReadFile(path, contents) || contents.size() < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.key != key || header.fontCount != fonts.size() ||
+        header.texWidth <= 0 || header.texHeight <= 0) {
+        return false;
+    }
+
+    // Validate the whole layout before touching the atlas, so a truncated
+    // file falls back to a normal build.
+    size_t offset = sizeof(header) + sizeof(atlas->TexUvLines);
+    std::vector<CachedFont> cachedFonts(fonts.size());
+    std::vector<size_t> glyphOffsets(fonts.size());
+    for (size_t i = 0; i < fonts.size(); i++) {
+        if (offset + sizeof(CachedFont) > contents.size()) {
+            return false;
+        }
+        std::memcpy(&cachedFonts[i], contents.data() + offset, sizeof(CachedFont));
+        glyphOffsets[i] = offset + sizeof(CachedFont);
+        offset = glyphOffsets[i] + cachedFonts[i].glyphCount * sizeof(CachedGlyph);
+    }
+    size_t pixelCount = static_cast<size_t>(header.texWidth) * static_cast<size_t>(header.texHeight);
+    if (offset + pixelCount != contents.size()) {
+        return false;
+    }
+
+    atlas->ClearTexData();
+    for (size_t i = 0; i < fonts.size(); i++) {
+        ImFont* font = fonts[i];
+        ImFontAtlasBuildSetupFont(atlas, font, const_cast<ImFontConfig*>(font->ConfigData),
+                                  cachedFonts[i].ascent, cachedFonts[i].descent);
+        font->FontSize = cachedFonts[i].size;
+
+        // Glyph positions were final when cached, so no source config is
+        // passed and nothing is re-adjusted.
+        for (uint32_t g = 0; g < cachedFonts[i].glyphCount; g++) {
+            CachedGlyph glyph;
+            std::memcpy(&glyph, contents.data() + glyphOffsets[i] + g * sizeof(CachedGlyph), sizeof(glyph));
+            font->AddGlyph(nullptr, static_cast<ImWchar>(glyph.codepoint),
+                           glyph.x0, glyph.y0, glyph.x1, glyph.y1,
+                           glyph.u0, glyph.v0, glyph.u1, glyph.v1, glyph.advanceX);
+        }
+        font->BuildLookupTable();
+    }
+
+    unsigned char* pixels = static_cast<unsigned char*>(IM_ALLOC(pixelCount));
+    std::memcpy(pixels, contents.data() + offset, pixelCount);
+    std::memcpy(atlas->TexUvLines, contents.data() + sizeof(header), sizeof(atlas->TexUvLines));
+    atlas->TexPixelsAlpha8 = pixels;
+    atlas->TexWidth = header.texWidth;
+    atlas->TexHeight = header.texHeight;
+    atlas->TexUvScale = ImVec2(header.uvScale[0], header.uvScale[1]);
+    atlas->TexUvWhitePixel = ImVec2(header.uvWhitePixel[0], header.uvWhitePixel[1]);
+    atlas->TexReady = true;
+    return true;
+}
+
+bool FontAtlasCache::Save(ImFontAtlas* atlas, uint64_t key, const std::vector<ImFont*>& fonts) const {
+    if (!atlas->TexPixelsAlpha8 || atlas->TexWidth <= 0 || atlas->TexHeight <= 0) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.fontCount = static_cast<uint32_t>(fonts.size());
+    header.key = key;
+    header.texWidth = atlas->TexWidth;
+    header.texHeight = atlas->TexHeight;
+    header.uvScale[0] = atlas->TexUvScale.x;
+    header.uvScale[1] = atlas->TexUvScale.y;
+    header.uvWhitePixel[0] = atlas->TexUvWhitePixel.x;
+    header.uvWhitePixel[1] = atlas->TexUvWhitePixel.y;
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(atlas->TexUvLines), sizeof(atlas->TexUvLines));
+
+        for (ImFont* font : fonts) {
+            CachedFont cached;
+            cached.size = font->FontSize;
+            cached.ascent = font->Ascent;
+            cached.descent = font->Descent;
+            cached.glyphCount = static_cast<uint32_t>(font->Glyphs.Size);
+            out.write(reinterpret_cast<const char*>(&cached), sizeof(cached));
+
+            for (const ImFontGlyph& source : font->Glyphs) {
+                CachedGlyph glyph;
+                glyph.codepoint = source.Codepoint;
+                glyph.advanceX = source.AdvanceX;
+                glyph.x0 = source.X0;
+                glyph.y0 = source.Y0;
+                glyph.x1 = source.X1;
+                glyph.y1 = source.Y1;
+                glyph.u0 = source.U0;
+                glyph.v0 = source.V0;
+                glyph.u1 = source.U1;
+                glyph.v1 = source.V1;
+                out.write(reinterpret_cast<const char*>(&glyph), sizeof(glyph));
+            }
+        }
+
+        out.write(reinterpret_cast<const char*>(atlas->TexPixelsAlpha8),
+                  static_cast<std::streamsize>(atlas->TexWidth) * atlas->TexHeight);
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+#else
+
+bool FontAtlasCache::Restore(ImFontAtlas*, uint64_t, const std::vector<ImFont*>&) const {
+    return false;
+}
+
+bool FontAtlasCache::Save(ImFontAtlas*, uint64_t, const std::vector<ImFont*>&) const {
+    return false;
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include "heartbeat_scheduler.h"
+#include "auth_handler.h"
+#include "config.h"
+#include <algorithm>
+#include <cmath>
+
+HeartbeatConfig::HeartbeatConfig()
+    : minInterval(HEARTBEAT_MIN_INTERVAL),
+      maxInterval(HEARTBEAT_MAX_INTERVAL),
+      expiryFraction(HEARTBEAT_EXPIRY_FRACTION),
+      jitter(HEARTBEAT_JITTER),
+      backoffBase(HEARTBEAT_BACKOFF_BASE),
+      backoffMax(HEARTBEAT_BACKOFF_MAX) {
+}
+
+HeartbeatScheduler::HeartbeatScheduler(const HeartbeatConfig& heartbeatConfig)
+    : config(heartbeatConfig),
+      random(std::random_device()()),
+      nextId(1),
+      inFlight(0),
+      stopping(false),
+      stats(),
+      cancellation(CancellationToken::Create()) {
+    timerThread = std::thread(&HeartbeatScheduler::Run, this);
+}
+
+HeartbeatScheduler::~HeartbeatScheduler() {
+    Stop();
+}
+
+void HeartbeatScheduler::Stop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopping = true;
+    wake.notify_all();
+    lock.unlock();
+
+    if (timerThread.joinable()) {
+        timerThread.join();
+    }
+
+    // Checks already handed to the event loop call back into this object;
+    // cancelling makes them do so right away.
+    cancellation.Cancel();
+    lock.lock();
+    idle.wait(lock, [this] { return inFlight == 0; });
+}
+
+HeartbeatScheduler::SessionId HeartbeatScheduler::Add(AuthHandler& handler, std::function<void()> onLost) {
+    std::lock_guard<std::mutex> lock(mutex);
+    SessionId id = nextId++;
+    Session& session = sessions[id];
+    session.handler = &handler;
+    session.onLost = std::move(onLost);
+    session.failures = 0;
+    session.generation = 0;
+    session.inFlight = false;
+    ScheduleLocked(id, session);
+    return id;
+}
+
+void HeartbeatScheduler::Remove(SessionId id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this, id] {
+        auto it = sessions.find(id);
+        return it == sessions.end() || !it->second.inFlight;
+    });
+    // Any queued entry for this id is skipped when it comes due.
+    sessions.erase(id);
+}
+
+HeartbeatStats HeartbeatScheduler::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Drop entries left behind by removed sessions so the top is real.
+    while (!schedule.empty()) {
+        const Due& next = schedule.top();
+        auto it = sessions.find(next.id);
+        if (it != sessions.end() && it->second.generation == next.generation) {
+            break;
+        }
+        schedule.pop();
+    }
+
+    HeartbeatStats result = stats;
+    result.sessions = sessions.size();
+    result.nextScheduledAt = 0;
+    if (!schedule.empty()) {
+        auto untilNext = schedule.top().when - Clock::now();
+        auto wallClock = std::chrono::system_clock::now() +
+                         std::chrono::duration_cast<std::chrono::system_clock::duration>(untilNext);
+        result.nextScheduledAt = std::chrono::system_clock::to_time_t(wallClock);
+    }
+    return result;
+}
+
+double HeartbeatScheduler::NextDelayLocked(const Session& session) {
+    double delay;
+    if (session.failures > 0) {
+        double exponent = std::min<unsigned>(session.failures - 1, 30);
+        delay = std::min<double>(config.backoffMax, config.backoffBase * std::pow(2.0, exponent));
+    } else {
+        delay = config.maxInterval;
+        std::time_t expiresAt = session.handler->GetExpiresAt();
+        if (expiresAt > 0) {
+            double remaining = static_cast<double>(expiresAt - std::time(nullptr));
+            delay = std::max<double>(config.minInterval,
+                                     std::min<double>(config.maxInterval, remaining * config.expiryFraction));
+        }
+    }
+
+    std::uniform_real_distribution<double> spread(1.0 - config.jitter, 1.0 + config.jitter);
+    return delay * spread(random);
+}
+
+void HeartbeatScheduler::ScheduleLocked(SessionId id, Session& session) {
+    session.generation++;
+
+    Due due;
+    due.when = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(NextDelayLocked(session)));
+    due.id = id;
+    due.generation = session.generation;
+    schedule.push(due);
+    wake.notify_one();
+}
+
+void HeartbeatScheduler::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        if (schedule.empty()) {
+            wake.wait(lock);
+            continue;
+        }
+
+        Due next = schedule.top();
+        if (Clock::now() < next.when) {
+            wake.wait_until(lock, next.when);
+            continue;
+        }
+        schedule.pop();
+
+        auto it = sessions.find(next.id);
+        if (it == sessions.end() || it->second.generation != next.generation || it->second.inFlight) {
+            continue;
+        }
+
+        it->second.inFlight = true;
+        inFlight++;
+        stats.sent++;
+        AuthHandler* handler = it->second.handler;
+        SessionId id = next.id;
+
+        // CheckSessionAsync may complete synchronously, and OnResult takes
+        // the lock.
+        lock.unlock();
+        handler->CheckSessionAsync([this, id](bool valid) {
+            OnResult(id, valid);
+        }, OperationContext(cancellation));
+        lock.lock();
+    }
+}
+
+void HeartbeatScheduler::OnResult(SessionId id, bool valid) {
+    std::function<void()> onLost;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight--;
+
+        auto it = sessions.find(id);
+        if (it != sessions.end()) {
+            Session& session = it->second;
+            session.inFlight = false;
+
+            if (valid) {
+                stats.succeeded++;
+                session.failures = 0;
+                ScheduleLocked(id, session);
+            } else if (stopping) {
+                // Aborted by Stop(); the session is neither lost nor failing.
+            } else if (session.handler->IsAuthenticated()) {
+                // CheckSession keeps the session when the server could not be
+                // reached; only a definite rejection ends it.
+                stats.failures++;
+                session.failures++;
+                ScheduleLocked(id, session);
+            } else {
+                stats.sessionsLost++;
+                onLost = std::move(session.onLost);
+                sessions.erase(it);
+            }
+        }
+        idle.notify_all();
+    }
+
+    if (onLost) {
+        onLost();
+    }
+}
@@ -1,17 +1,197 @@
 #include "http_client.h"
+#include "http_event_loop.h"
+#include "curl_pool.h"
+#include "http_metrics.h"
+#include "config.h"
 #include <curl/curl.h>
 #include <iostream>
 
-HTTPClient::HTTPClient() {
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+namespace {
+
+// Lets curl abort a transfer on its own once the token is cancelled. The event
+// loop removes cancelled transfers as soon as it is woken; this covers the
+// blocking path, which curl drives itself.
+int XferInfoCallback(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    const OperationContext* context = static_cast<const OperationContext*>(userp);
+    return context->cancellation.IsCancelled() ? 1 : 0;
+}
+
+void RecordMetrics(PendingTransfer& transfer) {
+    CURL* curl = transfer.curl;
+    HTTPTimings timings;
+    long newConnects = 0;
+    curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &newConnects);
+    timings.newConnection = newConnects > 0;
+
+    curl_off_t value = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &value);
+    timings.nameLookupUs = value;
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &value);
+    timings.connectUs = value;
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &value);
+    timings.appConnectUs = value;
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &value);
+    timings.startTransferUs = value;
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &value);
+    timings.totalUs = value;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &value);
+    timings.bytesSent = value > 0 ? static_cast<uint64_t>(value) : 0;
+    curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &value);
+    timings.bytesReceived = value > 0 ? static_cast<uint64_t>(value) : 0;
+
+    HTTPMetrics::Instance().RecordSuccess(transfer.url, timings);
+}
+
+// Feeds the outcome of a transfer sent to a mirror into its stats. Server
+// errors count against the mirror like transport failures do.
+void RecordMirror(PendingTransfer& transfer, const HTTPResponse& response) {
+    if (!transfer.mirrors) {
+        return;
+    }
+    if (response.success && response.statusCode < 500) {
+        curl_off_t totalUs = 0;
+        curl_easy_getinfo(transfer.curl, CURLINFO_TOTAL_TIME_T, &totalUs);
+        transfer.mirrors->RecordSuccess(transfer.mirror, totalUs);
+    } else {
+        transfer.mirrors->RecordFailure(transfer.mirror);
+    }
+}
+
+// Accept and Content-Type lists for every pair of formats, built once and
+// shared by all transfers; curl only reads them.
+struct curl_slist* RequestHeaders(WireFormat acceptFormat, const WireFormat* bodyFormat) {
+    static const int FORMATS = 3;
+    struct HeaderLists {
+        // [accept][0] has no Content-Type; [accept][body + 1] does.
+        struct curl_slist* lists[FORMATS][FORMATS + 1];
+
+        HeaderLists() {
+            for (int accept = 0; accept < FORMATS; accept++) {
+                std::string acceptHeader = "Accept: " + WireFormatAccept(static_cast<WireFormat>(accept));
+                lists[accept][0] = curl_slist_append(nullptr, acceptHeader.c_str());
+                for (int body = 0; body < FORMATS; body++) {
+                    std::string contentType = std::string("Content-Type: ") +
+                                              WireFormatContentType(static_cast<WireFormat>(body));
+                    struct curl_slist* list = curl_slist_append(nullptr, acceptHeader.c_str());
+                    lists[accept][body + 1] = curl_slist_append(list, contentType.c_str());
+                }
+            }
+        }
+    };
+    static const HeaderLists headers;
+    return headers.lists[static_cast<int>(acceptFormat)][bodyFormat ? static_cast<int>(*bodyFormat) + 1 : 0];
+}
+
+// The path of `url`, without scheme, host or query.
+std::string UrlPath(const std::string& url) {
+    size_t start = url.find("://");
+    start = url.find('/', start == std::string::npos ? 0 : start + 3);
+    if (start == std::string::npos) {
+        return "/";
+    }
+    size_t end = url.find_first_of("?#", start);
+    return url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+}
+
+bool HTTPVersionFromName(const std::string& name, HTTPVersion& version) {
+    if (name == "1.1") {
+        version = HTTPVersion::Http1;
+    } else if (name == "2") {
+        version = HTTPVersion::Http2;
+    } else if (name == "h2c") {
+        version = HTTPVersion::Http2PriorKnowledge;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+struct HTTPClient::HedgeState {
+    std::atomic<unsigned long long> calls{0};
+    std::atomic<unsigned long long> hedgesIssued{0};
+    std::atomic<unsigned long long> hedgesWon{0};
+    std::atomic<unsigned long long> hedgesDenied{0};
+    // Hedges that may still be sent, in thousandths. Every call earns
+    // HEDGE_BUDGET_PERCENT of one, up to HEDGE_BUDGET_BURST.
+    std::atomic<long long> budgetMilli{0};
+    LatencyHistogram latency;
+
+    void EarnBudget() {
+        const long long earned = static_cast<long long>(HEDGE_BUDGET_PERCENT * 10.0);
+        const long long cap = static_cast<long long>(HEDGE_BUDGET_BURST * 1000.0);
+        long long current = budgetMilli.load(std::memory_order_relaxed);
+        while (current < cap &&
+               !budgetMilli.compare_exchange_weak(current, std::min(current + earned, cap),
+                                                  std::memory_order_relaxed)) {
+        }
+    }
+
+    bool SpendBudget() {
+        long long current = budgetMilli.load(std::memory_order_relaxed);
+        while (current >= 1000) {
+            if (budgetMilli.compare_exchange_weak(current, current - 1000, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// One PostHedged call: the original request, the hedge if one is sent, and
+// the caller's callback, which runs once for whichever reply wins.
+struct HTTPClient::HedgeRace {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<bool> finished{false};
+    // Copies sent and not yet completed.
+    std::atomic<int> outstanding{1};
+    CancellationToken primaryToken = CancellationToken::Create();
+    CancellationToken hedgeToken = CancellationToken::Create();
+    CancellationToken parent;
+    uint64_t parentCallback = 0;
+    // Built up front so the timer only has to hand it to the loop.
+    std::unique_ptr<PendingTransfer> hedgeTransfer;
+    HTTPCallback callback;
+};
+
+const char* HTTPVersionName(HTTPVersion version) {
+    switch (version) {
+    case HTTPVersion::Http2: return "2";
+    case HTTPVersion::Http2PriorKnowledge: return "h2c";
+    default: return "1.1";
+    }
+}
+
+HTTPClient::HTTPClient()
+    : wire(std::make_shared<WireState>()),
+      hedge(std::make_shared<HedgeState>()),
+      httpVersion(HTTPVersion::Http1),
+      acceptCompressed(HTTP_ACCEPT_COMPRESSED),
+      userAgent(HTTP_USER_AGENT) {
+    CurlPool::Instance();
+
+    WireFormat preferred = WireFormat::Json;
+    WireFormatFromName(HTTP_WIRE_FORMAT, preferred);
+    SetWireFormat(preferred);
+    HTTPVersionFromName(HTTP_VERSION, httpVersion);
 }
 
 HTTPClient::~HTTPClient() {
-    curl_global_cleanup();
 }
 
 size_t HTTPClient::WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    ((std::string*)userp)->append((char*)contents, size * nmemb);
+    PendingTransfer* transfer = static_cast<PendingTransfer*>(userp);
+    if (transfer->readBuffer.empty()) {
+        // Size the buffer once from Content-Length instead of growing it
+        // chunk by chunk; -1 when the server did not send one.
+        curl_off_t length = -1;
+        curl_easy_getinfo(transfer->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        if (length > 0 && length <= HTTP_MAX_PRESIZE_BYTES) {
+            transfer->readBuffer.reserve(static_cast<size_t>(length));
+        }
+    }
+    transfer->readBuffer.append(static_cast<char*>(contents), size * nmemb);
     return size * nmemb;
 }
 
@@ -19,96 +199,530 @@ bool HTTPClient::VerifySSL(const std::string& url) {
     return url.substr(0, 5) == "https";
 }
 
-HTTPResponse HTTPClient::Get(const std::string& url) {
-    HTTPResponse response;
-    response.success = false;
-    response.statusCode = 0;
-    
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        response.error = "Failed to initialize CURL";
-        return response;
+bool HTTPClient::Prepare(PendingTransfer& transfer, bool isPost) {
+    transfer.curl = CurlPool::Instance().Acquire();
+    if (!transfer.curl) {
+        return false;
     }
-    
-    std::string readBuffer;
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+
+    CURL* curl = transfer.curl;
+    curl_easy_setopt(curl, CURLOPT_URL, transfer.url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "BR-MODS-Client/1.0");
-    
-    if (VerifySSL(url)) {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, transfer.userAgent.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    const HTTPRequestOptions& options = transfer.options;
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, transfer.context.TimeoutMs(options.timeoutMs));
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, transfer.context.TimeoutMs(options.connectTimeoutMs));
+    if (options.lowSpeedLimit > 0 && options.lowSpeedTimeSec > 0) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, options.lowSpeedLimit);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, options.lowSpeedTimeSec);
     }
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    if (res == CURLE_OK) {
-        long http_code = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-        response.statusCode = static_cast<int>(http_code);
-        response.body = readBuffer;
-        response.success = true;
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, options.dnsCacheTtlSec);
+
+    switch (transfer.httpVersion) {
+    case HTTPVersion::Http1:
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+        break;
+    case HTTPVersion::Http2:
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_0);
+        break;
+    case HTTPVersion::Http2PriorKnowledge:
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+        break;
+    }
+    if (transfer.httpVersion != HTTPVersion::Http1) {
+        // Wait for a connection that is still being set up so the request
+        // becomes another stream on it rather than a new connection.
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+    if (transfer.acceptCompressed) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
+
+    if (transfer.context.cancellation.CanBeCancelled()) {
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, XferInfoCallback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &transfer.context);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    }
+
+    if (transfer.preconnect) {
+        transfer.headers = RequestHeaders(transfer.acceptFormat, nullptr);
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    } else if (isPost) {
+        transfer.headers = RequestHeaders(transfer.acceptFormat, &transfer.bodyFormat);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, transfer.postData.data());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(transfer.postData.size()));
     } else {
-        response.error = curl_easy_strerror(res);
+        transfer.headers = RequestHeaders(transfer.acceptFormat, nullptr);
     }
-    
-    curl_easy_cleanup(curl);
-    return response;
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer.headers);
+
+    if (VerifySSL(transfer.url)) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    }
+
+    return true;
 }
 
-HTTPResponse HTTPClient::Post(const std::string& url, const json& data) {
+HTTPResponse HTTPClient::BuildResponse(PendingTransfer& transfer, int result) {
     HTTPResponse response;
     response.success = false;
+    response.cancelled = false;
     response.statusCode = 0;
-    
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        response.error = "Failed to initialize CURL";
+    response.httpVersion = 0;
+    response.format = WireFormat::Json;
+    response.connectFailed = false;
+
+    if (result != CURLE_OK && transfer.context.cancellation.IsCancelled()) {
+        response.cancelled = true;
+        response.error = "Request cancelled";
         return response;
     }
-    
-    std::string readBuffer;
-    std::string postData = data.dump();
-    
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, "Accept: application/json");
-    
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, postData.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "BR-MODS-Client/1.0");
-    
-    if (VerifySSL(url)) {
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+
+    if (!transfer.curl) {
+        response.error = "Failed to initialize CURL";
+        return response;
     }
-    
-    CURLcode res = curl_easy_perform(curl);
-    
-    if (res == CURLE_OK) {
+
+    if (result == CURLE_OK) {
         long http_code = 0;
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &http_code);
         response.statusCode = static_cast<int>(http_code);
-        response.body = readBuffer;
+        long version = 0;
+        curl_easy_getinfo(transfer.curl, CURLINFO_HTTP_VERSION, &version);
+        switch (version) {
+        case CURL_HTTP_VERSION_1_0: response.httpVersion = 10; break;
+        case CURL_HTTP_VERSION_1_1: response.httpVersion = 11; break;
+        case CURL_HTTP_VERSION_2_0: response.httpVersion = 20; break;
+        case CURL_HTTP_VERSION_3: response.httpVersion = 30; break;
+        }
+        char* contentType = nullptr;
+        curl_easy_getinfo(transfer.curl, CURLINFO_CONTENT_TYPE, &contentType);
+        if (contentType) {
+            WireFormatFromContentType(contentType, response.format);
+        }
+        response.body = std::move(transfer.readBuffer);
         response.success = true;
+        RecordMirror(transfer, response);
+        if (transfer.mirrorProbe) {
+            // Only here for RecordMirror.
+        } else if (transfer.preconnect) {
+            CurlPool::Instance().RecordPreconnect(transfer.curl);
+        } else {
+            CurlPool::Instance().RecordTransfer(transfer.curl);
+            RecordMetrics(transfer);
+        }
     } else {
-        response.error = curl_easy_strerror(res);
+        response.error = curl_easy_strerror(static_cast<CURLcode>(result));
+        long requestSize = 0;
+        curl_easy_getinfo(transfer.curl, CURLINFO_REQUEST_SIZE, &requestSize);
+        response.connectFailed = requestSize == 0;
+        RecordMirror(transfer, response);
+        if (!transfer.preconnect) {
+            HTTPMetrics::Instance().RecordFailure(transfer.url);
+        }
     }
-    
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+
     return response;
 }
 
+std::unique_ptr<PendingTransfer> HTTPClient::CopyTransfer(const PendingTransfer& sent) {
+    std::unique_ptr<PendingTransfer> copy(new PendingTransfer());
+    copy->url = sent.url;
+    copy->context = sent.context;
+    copy->postData = sent.postData;
+    copy->bodyFormat = sent.bodyFormat;
+    copy->acceptFormat = sent.acceptFormat;
+    copy->httpVersion = sent.httpVersion;
+    copy->acceptCompressed = sent.acceptCompressed;
+    copy->options = sent.options;
+    copy->userAgent = sent.userAgent;
+    copy->preconnect = sent.preconnect;
+    copy->mirrors = sent.mirrors;
+    copy->mirror = sent.mirror;
+    copy->mirrorPath = sent.mirrorPath;
+    copy->mirrorsTried = sent.mirrorsTried;
+    return copy;
+}
+
+std::unique_ptr<PendingTransfer> HTTPClient::Negotiate(WireState& state, PendingTransfer& sent,
+                                                       const HTTPResponse& response) {
+    if (!response.success) {
+        return nullptr;
+    }
+
+    if (response.statusCode == 415 && sent.bodyFormat != WireFormat::Json) {
+        state.binaryRejected.store(true);
+        state.request.store(WireFormat::Json);
+
+        std::unique_ptr<PendingTransfer> retry = CopyTransfer(sent);
+        retry->bodyFormat = WireFormat::Json;
+        retry->postData = DecodeBody(sent.postData, sent.bodyFormat).dump();
+        return retry;
+    }
+
+    if (response.format != WireFormat::Json && response.format == state.preferred &&
+        !state.binaryRejected.load()) {
+        state.request.store(response.format);
+    }
+    return nullptr;
+}
+
+std::unique_ptr<PendingTransfer> HTTPClient::Failover(PendingTransfer& sent, const HTTPResponse& response) {
+    if (response.success || !response.connectFailed || !sent.mirrors || sent.mirrorProbe) {
+        return nullptr;
+    }
+    int next = sent.mirrors->Pick(sent.mirrorsTried);
+    if (next < 0) {
+        return nullptr;
+    }
+
+    std::unique_ptr<PendingTransfer> retry = CopyTransfer(sent);
+    retry->mirror = next;
+    retry->mirrorsTried |= 1u << next;
+    retry->url = sent.mirrors->BaseUrl(next) + sent.mirrorPath;
+    return retry;
+}
+
+std::unique_ptr<PendingTransfer> HTTPClient::FollowUp(WireState& state, PendingTransfer& sent,
+                                                      const HTTPResponse& response) {
+    std::unique_ptr<PendingTransfer> next = Failover(sent, response);
+    return next ? std::move(next) : Negotiate(state, sent, response);
+}
+
+HTTPResponse HTTPClient::Perform(std::unique_ptr<PendingTransfer> transfer, bool isPost) {
+    bool viaLoop = transfer->context.cancellation.CanBeCancelled() || transfer->httpVersion != HTTPVersion::Http1;
+    if (viaLoop && !HTTPEventLoop::Instance().IsLoopThread()) {
+        // curl_easy_perform only looks at the token from its progress
+        // callback, which can be a second apart while waiting on the network,
+        // and cannot share an HTTP/2 connection with other threads.
+        auto promise = std::make_shared<std::promise<HTTPResponse>>();
+        std::future<HTTPResponse> future = promise->get_future();
+        Dispatch(wire, std::move(transfer), isPost, [promise](const HTTPResponse& response) {
+            promise->set_value(response);
+        });
+        return future.get();
+    }
+
+    if (transfer->context.cancellation.IsCancelled()) {
+        return BuildResponse(*transfer, CURLE_ABORTED_BY_CALLBACK);
+    }
+    if (!Prepare(*transfer, isPost)) {
+        return BuildResponse(*transfer, CURLE_FAILED_INIT);
+    }
+
+    CURLcode res = curl_easy_perform(transfer->curl);
+    HTTPResponse response = BuildResponse(*transfer, res);
+
+    std::unique_ptr<PendingTransfer> retry = FollowUp(*wire, *transfer, response);
+    if (retry) {
+        return Perform(std::move(retry), isPost);
+    }
+    return response;
+}
+
+void HTTPClient::Dispatch(std::shared_ptr<WireState> state, std::unique_ptr<PendingTransfer> transfer,
+                          bool isPost, HTTPCallback callback) {
+    if (transfer->context.cancellation.IsCancelled()) {
+        callback(BuildResponse(*transfer, CURLE_ABORTED_BY_CALLBACK));
+        return;
+    }
+    if (!Prepare(*transfer, isPost)) {
+        callback(BuildResponse(*transfer, CURLE_FAILED_INIT));
+        return;
+    }
+
+    transfer->onDone = [state, isPost, callback](PendingTransfer& done, CURLcode result) {
+        HTTPResponse response = BuildResponse(done, result);
+        std::unique_ptr<PendingTransfer> retry = FollowUp(*state, done, response);
+        if (retry) {
+            Dispatch(state, std::move(retry), isPost, callback);
+            return;
+        }
+        callback(response);
+    };
+    HTTPEventLoop::Instance().Submit(std::move(transfer));
+}
+
+std::unique_ptr<PendingTransfer> HTTPClient::NewTransfer(const std::string& url,
+                                                         const OperationContext& context) const {
+    return NewTransfer(url, GetOptions(url), context);
+}
+
+std::unique_ptr<PendingTransfer> HTTPClient::NewTransfer(const std::string& url, const HTTPRequestOptions& options,
+                                                         const OperationContext& context) const {
+    std::unique_ptr<PendingTransfer> transfer(new PendingTransfer());
+    transfer->url = url;
+    transfer->context = context;
+    transfer->acceptFormat = wire->preferred;
+    transfer->bodyFormat = wire->request.load();
+    transfer->httpVersion = httpVersion;
+    transfer->acceptCompressed = acceptCompressed;
+    transfer->options = options;
+    transfer->userAgent = userAgent;
+
+    std::string path;
+    if (mirrors && mirrors->Match(url, path) >= 0) {
+        int picked = mirrors->Pick();
+        transfer->mirrors = mirrors;
+        transfer->mirror = picked;
+        transfer->mirrorPath = path;
+        transfer->mirrorsTried = 1u << picked;
+        transfer->url = mirrors->BaseUrl(picked) + path;
+
+        int probe = mirrors->ClaimProbe(picked);
+        if (probe >= 0) {
+            ProbeMirror(probe, *transfer);
+        }
+    }
+    return transfer;
+}
+
+void HTTPClient::ProbeMirror(int index, const PendingTransfer& transfer) const {
+    std::unique_ptr<PendingTransfer> probe = CopyTransfer(transfer);
+    probe->context = OperationContext();
+    probe->postData.clear();
+    probe->bodyFormat = WireFormat::Json;
+    probe->preconnect = true;
+    probe->mirrorProbe = true;
+    probe->mirror = index;
+    probe->mirrorsTried = 1u << index;
+    probe->url = mirrors->BaseUrl(index) + transfer.mirrorPath;
+    Dispatch(wire, std::move(probe), false, [](const HTTPResponse&) {});
+}
+
+HTTPResponse HTTPClient::Get(const std::string& url, const OperationContext& context) {
+    return Perform(NewTransfer(url, context), false);
+}
+
+HTTPResponse HTTPClient::Post(const std::string& url, const RequestBody& body, const OperationContext& context) {
+    std::unique_ptr<PendingTransfer> transfer = NewTransfer(url, context);
+    body.EncodeTo(transfer->bodyFormat, transfer->postData);
+    return Perform(std::move(transfer), true);
+}
+
+HTTPResponse HTTPClient::Get(const std::string& url, const HTTPRequestOptions& options,
+                             const OperationContext& context) {
+    return Perform(NewTransfer(url, options, context), false);
+}
+
+HTTPResponse HTTPClient::Post(const std::string& url, const RequestBody& body, const HTTPRequestOptions& options,
+                              const OperationContext& context) {
+    std::unique_ptr<PendingTransfer> transfer = NewTransfer(url, options, context);
+    body.EncodeTo(transfer->bodyFormat, transfer->postData);
+    return Perform(std::move(transfer), true);
+}
+
+void HTTPClient::GetAsync(const std::string& url, HTTPCallback callback, const OperationContext& context) {
+    Dispatch(wire, NewTransfer(url, context), false, std::move(callback));
+}
+
+void HTTPClient::PostAsync(const std::string& url, const RequestBody& body, HTTPCallback callback,
+                           const OperationContext& context) {
+    std::unique_ptr<PendingTransfer> transfer = NewTransfer(url, context);
+    body.EncodeTo(transfer->bodyFormat, transfer->postData);
+    Dispatch(wire, std::move(transfer), true, std::move(callback));
+}
+
+void HTTPClient::GetAsync(const std::string& url, const HTTPRequestOptions& options, HTTPCallback callback,
+                          const OperationContext& context) {
+    Dispatch(wire, NewTransfer(url, options, context), false, std::move(callback));
+}
+
+void HTTPClient::PostAsync(const std::string& url, const RequestBody& body, const HTTPRequestOptions& options,
+                           HTTPCallback callback, const OperationContext& context) {
+    std::unique_ptr<PendingTransfer> transfer = NewTransfer(url, options, context);
+    body.EncodeTo(transfer->bodyFormat, transfer->postData);
+    Dispatch(wire, std::move(transfer), true, std::move(callback));
+}
+
+std::future<HTTPResponse> HTTPClient::GetAsync(const std::string& url) {
+    auto promise = std::make_shared<std::promise<HTTPResponse>>();
+    std::future<HTTPResponse> future = promise->get_future();
+    GetAsync(url, [promise](const HTTPResponse& response) {
+        promise->set_value(response);
+    });
+    return future;
+}
+
+std::future<HTTPResponse> HTTPClient::PostAsync(const std::string& url, const RequestBody& body) {
+    auto promise = std::make_shared<std::promise<HTTPResponse>>();
+    std::future<HTTPResponse> future = promise->get_future();
+    PostAsync(url, body, [promise](const HTTPResponse& response) {
+        promise->set_value(response);
+    });
+    return future;
+}
+
+bool HTTPClient::Preconnect(const std::string& url, const OperationContext& context) {
+    std::unique_ptr<PendingTransfer> transfer = NewTransfer(url, context);
+    transfer->preconnect = true;
+    transfer->bodyFormat = WireFormat::Json;
+    return Perform(std::move(transfer), false).success;
+}
+
+void HTTPClient::FinishHedged(const std::shared_ptr<HedgeState>& state, const std::shared_ptr<HedgeRace>& race,
+                              const HTTPResponse& response, bool fromHedge) {
+    int remaining = race->outstanding.fetch_sub(1) - 1;
+    // A copy that got no reply at all leaves the race to the other one.
+    if (!response.success && remaining > 0) {
+        return;
+    }
+    if (race->finished.exchange(true)) {
+        return;
+    }
+
+    (fromHedge ? race->primaryToken : race->hedgeToken).Cancel();
+    race->parent.RemoveCallback(race->parentCallback);
+
+    if (response.success) {
+        auto elapsed = std::chrono::steady_clock::now() - race->start;
+        state->latency.Record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        if (fromHedge) {
+            state->hedgesWon.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    race->callback(response);
+}
+
+HTTPResponse HTTPClient::PostHedged(const std::string& url, const RequestBody& body, const OperationContext& context) {
+    if (HTTPEventLoop::Instance().IsLoopThread()) {
+        return Post(url, body, context);
+    }
+
+    auto promise = std::make_shared<std::promise<HTTPResponse>>();
+    std::future<HTTPResponse> future = promise->get_future();
+    PostHedgedAsync(url, body, [promise](const HTTPResponse& response) {
+        promise->set_value(response);
+    }, context);
+    return future.get();
+}
+
+void HTTPClient::PostHedgedAsync(const std::string& url, const RequestBody& body, HTTPCallback callback,
+                                 const OperationContext& context) {
+    std::shared_ptr<HedgeState> state = hedge;
+    state->calls.fetch_add(1, std::memory_order_relaxed);
+    state->EarnBudget();
+
+    double delayMs = HTTPMetrics::Instance().QuantileMs(url, HTTPPhase::Total, HEDGE_DELAY_PERCENTILE,
+                                                        HEDGE_MIN_SAMPLES);
+    if (delayMs < 0) {
+        PostAsync(url, body, std::move(callback), context);
+        return;
+    }
+    delayMs = std::max(delayMs, static_cast<double>(HEDGE_MIN_DELAY_MS));
+
+    auto race = std::make_shared<HedgeRace>();
+    race->callback = std::move(callback);
+    race->parent = context.cancellation;
+
+    OperationContext primaryContext(race->primaryToken);
+    primaryContext.deadline = context.deadline;
+    OperationContext hedgeContext(race->hedgeToken);
+    hedgeContext.deadline = context.deadline;
+
+    std::unique_ptr<PendingTransfer> primary = NewTransfer(url, primaryContext);
+    body.EncodeTo(primary->bodyFormat, primary->postData);
+    race->hedgeTransfer = NewTransfer(url, hedgeContext);
+    race->hedgeTransfer->bodyFormat = primary->bodyFormat;
+    race->hedgeTransfer->postData = primary->postData;
+
+    race->parentCallback = race->parent.OnCancel([race]() {
+        race->primaryToken.Cancel();
+        race->hedgeToken.Cancel();
+    });
+
+    std::shared_ptr<WireState> wireState = wire;
+    Dispatch(wireState, std::move(primary), true, [state, race](const HTTPResponse& response) {
+        FinishHedged(state, race, response, false);
+    });
+
+    HTTPEventLoop::Instance().RunAfter(
+        std::chrono::milliseconds(static_cast<long long>(delayMs)),
+        [state, race, wireState]() {
+            if (race->finished.load()) {
+                return;
+            }
+            if (!state->SpendBudget()) {
+                state->hedgesDenied.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            state->hedgesIssued.fetch_add(1, std::memory_order_relaxed);
+            race->outstanding.fetch_add(1);
+            Dispatch(wireState, std::move(race->hedgeTransfer), true, [state, race](const HTTPResponse& response) {
+                FinishHedged(state, race, response, true);
+            });
+        });
+}
+
+HedgeStats HTTPClient::GetHedgeStats() const {
+    HedgeStats stats;
+    stats.calls = hedge->calls.load(std::memory_order_relaxed);
+    stats.hedgesIssued = hedge->hedgesIssued.load(std::memory_order_relaxed);
+    stats.hedgesWon = hedge->hedgesWon.load(std::memory_order_relaxed);
+    stats.hedgesDenied = hedge->hedgesDenied.load(std::memory_order_relaxed);
+    HistogramSnapshot latency = hedge->latency.Snapshot();
+    stats.p50Ms = latency.QuantileMs(0.50);
+    stats.p99Ms = latency.QuantileMs(0.99);
+    return stats;
+}
+
+HTTPConnectionStats HTTPClient::GetConnectionStats() {
+    return CurlPool::Instance().GetStats();
+}
+
+void HTTPClient::SetWireFormat(WireFormat preferred) {
+    wire->preferred = preferred;
+    wire->request.store(WireFormat::Json);
+    wire->binaryRejected.store(false);
+}
+
+WireFormat HTTPClient::GetRequestFormat() const {
+    return wire->request.load();
+}
+
+void HTTPClient::SetHttpVersion(HTTPVersion version) {
+    httpVersion = version;
+}
+
+void HTTPClient::SetAcceptCompressed(bool enabled) {
+    acceptCompressed = enabled;
+}
+
+void HTTPClient::SetMirrors(const std::vector<std::string>& baseUrls) {
+    mirrors = baseUrls.size() >= 2 ? std::make_shared<MirrorSet>(baseUrls) : nullptr;
+}
+
+std::vector<MirrorStats> HTTPClient::GetMirrorStats() const {
+    return mirrors ? mirrors->Stats() : std::vector<MirrorStats>();
+}
+
+void HTTPClient::SetDefaultOptions(const HTTPRequestOptions& options) {
+    defaultOptions = options;
+}
+
+void HTTPClient::SetEndpointOptions(const std::string& url, const HTTPRequestOptions& options) {
+    endpointOptions[UrlPath(url)] = options;
+}
+
+HTTPRequestOptions HTTPClient::GetOptions(const std::string& url) const {
+    if (!endpointOptions.empty()) {
+        auto it = endpointOptions.find(UrlPath(url));
+        if (it != endpointOptions.end()) {
+            return it->second;
+        }
+    }
+    return defaultOptions;
+}
+
 void HTTPClient::SetTimeout(long timeout) {
+    defaultOptions.timeoutMs = timeout * 1000;
 }
 
-void HTTPClient::SetUserAgent(const std::string& userAgent) {
+void HTTPClient::SetUserAgent(const std::string& agent) {
+    userAgent = agent;
 }
@@ -0,0 +1,200 @@
+#include "http_event_loop.h"
+#include "config.h"
+#include "curl_pool.h"
+
+PendingTransfer::~PendingTransfer() {
+    context.cancellation.RemoveCallback(cancelCallback);
+    if (curl) {
+        CurlPool::Instance().Release(curl);
+    }
+}
+
+HTTPEventLoop::HTTPEventLoop() : multi(nullptr) {
+    // The pool must outlive the loop: constructing it first guarantees it is
+    // destroyed after us during static teardown.
+    CurlPool::Instance();
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, HTTP_POOL_MAX_CONNECTIONS);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    loopThread = std::thread(&HTTPEventLoop::Run, this);
+}
+
+HTTPEventLoop::~HTTPEventLoop() {
+    stopping.store(true);
+    if (multi) {
+        curl_multi_wakeup(multi);
+    }
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+    if (multi) {
+        curl_multi_cleanup(multi);
+    }
+}
+
+HTTPEventLoop& HTTPEventLoop::Instance() {
+    static HTTPEventLoop instance;
+    return instance;
+}
+
+void HTTPEventLoop::Submit(std::unique_ptr<PendingTransfer> transfer) {
+    if (!multi || stopping.load()) {
+        Complete(transfer.get(), CURLE_FAILED_INIT);
+        return;
+    }
+
+    if (transfer->context.cancellation.CanBeCancelled()) {
+        CURLM* handle = multi;
+        transfer->cancelCallback = transfer->context.cancellation.OnCancel([handle]() {
+            curl_multi_wakeup(handle);
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        submitted.push_back(std::move(transfer));
+    }
+    curl_multi_wakeup(multi);
+}
+
+void HTTPEventLoop::RunAfter(std::chrono::milliseconds delay, std::function<void()> task) {
+    if (!multi || stopping.load()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        timers.emplace(std::chrono::steady_clock::now() + delay, std::move(task));
+    }
+    curl_multi_wakeup(multi);
+}
+
+bool HTTPEventLoop::IsLoopThread() const {
+    return std::this_thread::get_id() == loopThread.get_id();
+}
+
+size_t HTTPEventLoop::InFlight() {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    return submitted.size() + active.size();
+}
+
+void HTTPEventLoop::Run() {
+    if (!multi) {
+        return;
+    }
+
+    while (!stopping.load()) {
+        AddSubmitted();
+        AbortCancelled();
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        ProcessCompleted();
+
+        int timeoutMs = RunTimers(1000);
+        curl_multi_poll(multi, nullptr, 0, timeoutMs, nullptr);
+    }
+
+    // Anything still queued or in flight at shutdown fails instead of
+    // leaving its caller waiting on a future that never resolves.
+    AddSubmitted();
+    std::unordered_map<CURL*, std::unique_ptr<PendingTransfer>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        remaining.swap(active);
+    }
+    for (auto& entry : remaining) {
+        curl_multi_remove_handle(multi, entry.first);
+        Complete(entry.second.get(), CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+void HTTPEventLoop::AddSubmitted() {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    for (auto& transfer : submitted) {
+        CURL* curl = transfer->curl;
+        curl_multi_add_handle(multi, curl);
+        active.emplace(curl, std::move(transfer));
+    }
+    submitted.clear();
+}
+
+void HTTPEventLoop::ProcessCompleted() {
+    CURLMsg* msg = nullptr;
+    int queued = 0;
+
+    while ((msg = curl_multi_info_read(multi, &queued)) != nullptr) {
+        if (msg->msg != CURLMSG_DONE) {
+            continue;
+        }
+
+        CURL* curl = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        curl_multi_remove_handle(multi, curl);
+
+        std::unique_ptr<PendingTransfer> transfer;
+        {
+            std::lock_guard<std::mutex> lock(submitMutex);
+            auto it = active.find(curl);
+            if (it == active.end()) {
+                continue;
+            }
+            transfer = std::move(it->second);
+            active.erase(it);
+        }
+
+        Complete(transfer.get(), result);
+    }
+}
+
+void HTTPEventLoop::AbortCancelled() {
+    std::vector<std::unique_ptr<PendingTransfer>> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        for (auto it = active.begin(); it != active.end();) {
+            if (it->second->context.cancellation.IsCancelled()) {
+                cancelled.push_back(std::move(it->second));
+                it = active.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& transfer : cancelled) {
+        curl_multi_remove_handle(multi, transfer->curl);
+        Complete(transfer.get(), CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+int HTTPEventLoop::RunTimers(int limitMs) {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::function<void()>> due;
+    int timeoutMs = limitMs;
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        auto it = timers.begin();
+        while (it != timers.end() && it->first <= now) {
+            due.push_back(std::move(it->second));
+            it = timers.erase(it);
+        }
+        if (it != timers.end()) {
+            auto untilNext = std::chrono::duration_cast<std::chrono::milliseconds>(it->first - now).count() + 1;
+            if (untilNext < timeoutMs) {
+                timeoutMs = static_cast<int>(untilNext);
+            }
+        }
+    }
+
+    // Tasks usually submit transfers; poll right away so they start now.
+    for (auto& task : due) {
+        task();
+    }
+    return due.empty() ? timeoutMs : 0;
+}
+
+void HTTPEventLoop::Complete(PendingTransfer* transfer, CURLcode result) {
+    if (transfer->onDone) {
+        transfer->onDone(*transfer, result);
+    }
+}
@@ -0,0 +1,335 @@
+#include "http_metrics.h"
+#include "config.h"
+#include <cstdarg>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+const size_t PHASE_COUNT = static_cast<size_t>(HTTPPhase::Count);
+
+// Path of `url` without scheme, host and query, e.g. "/api/validate".
+void PathOf(const std::string& url, const char*& begin, size_t& length) {
+    size_t start = url.find("://");
+    start = start == std::string::npos ? 0 : url.find('/', start + 3);
+    if (start == std::string::npos) {
+        begin = "/";
+        length = 1;
+        return;
+    }
+    size_t end = url.find_first_of("?#", start);
+    if (end == std::string::npos) {
+        end = url.size();
+    }
+    begin = url.data() + start;
+    length = end - start;
+}
+
+uint64_t Elapsed(int64_t fromUs, int64_t toUs) {
+    return toUs > fromUs ? static_cast<uint64_t>(toUs - fromUs) : 0;
+}
+
+std::string EscapeLabel(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void AppendFormat(std::string& out, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    va_list retry;
+    va_copy(retry, args);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length > 0 && static_cast<size_t>(length) < sizeof(line)) {
+        out.append(line, static_cast<size_t>(length));
+    } else if (length > 0) {
+        size_t start = out.size();
+        out.resize(start + static_cast<size_t>(length) + 1);
+        vsnprintf(&out[start], static_cast<size_t>(length) + 1, format, retry);
+        out.resize(start + static_cast<size_t>(length));
+    }
+    va_end(retry);
+}
+
+}
+
+const char* HTTPPhaseName(HTTPPhase phase) {
+    switch (phase) {
+    case HTTPPhase::DNS: return "dns";
+    case HTTPPhase::Connect: return "connect";
+    case HTTPPhase::TLS: return "tls";
+    case HTTPPhase::Server: return "server";
+    case HTTPPhase::Transfer: return "transfer";
+    case HTTPPhase::Total: return "total";
+    default: return "unknown";
+    }
+}
+
+double HistogramSnapshot::QuantileMs(double quantile) const {
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(count));
+    if (rank >= count) {
+        rank = count - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i + 1 < HTTP_LATENCY_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return HTTP_LATENCY_BOUNDS_US[i] / 1000.0;
+        }
+    }
+    return HTTP_LATENCY_BOUNDS_US[HTTP_LATENCY_BUCKETS - 2] / 1000.0;
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), sumUs(0) {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Record(uint64_t microseconds) {
+    size_t bucket = 0;
+    while (bucket + 1 < HTTP_LATENCY_BUCKETS && microseconds > HTTP_LATENCY_BOUNDS_US[bucket]) {
+        bucket++;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumUs.fetch_add(microseconds, std::memory_order_relaxed);
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+    // Buckets are read one by one while writers keep going, so the total is
+    // taken from the buckets themselves to keep the snapshot consistent.
+    HistogramSnapshot snapshot;
+    for (size_t i = 0; i < HTTP_LATENCY_BUCKETS; i++) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sumUs = sumUs.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+HTTPMetrics::HTTPMetrics() : slots(HTTP_METRICS_MAX_ENDPOINTS), other("other") {
+    for (auto& slot : slots) {
+        slot.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+HTTPMetrics::~HTTPMetrics() {
+    for (auto& slot : slots) {
+        delete slot.load(std::memory_order_relaxed);
+    }
+}
+
+HTTPMetrics& HTTPMetrics::Instance() {
+    static HTTPMetrics instance;
+    return instance;
+}
+
+HTTPMetrics::Endpoint& HTTPMetrics::Find(const std::string& url) {
+    const char* path = nullptr;
+    size_t length = 0;
+    PathOf(url, path, length);
+
+    Endpoint* created = nullptr;
+    for (auto& slot : slots) {
+        Endpoint* endpoint = slot.load(std::memory_order_acquire);
+        if (!endpoint) {
+            if (!created) {
+                created = new Endpoint(std::string(path, length));
+            }
+            if (slot.compare_exchange_strong(endpoint, created, std::memory_order_acq_rel)) {
+                return *created;
+            }
+            // Another thread filled the slot first; `endpoint` now holds its
+            // entry, which may be for this same path.
+        }
+        if (endpoint->name.compare(0, std::string::npos, path, length) == 0) {
+            delete created;
+            return *endpoint;
+        }
+    }
+    delete created;
+    return other;
+}
+
+void HTTPMetrics::RecordSuccess(const std::string& url, const HTTPTimings& timings) {
+    Endpoint& endpoint = Find(url);
+    endpoint.requests.fetch_add(1, std::memory_order_relaxed);
+    endpoint.bytesSent.fetch_add(timings.bytesSent, std::memory_order_relaxed);
+    endpoint.bytesReceived.fetch_add(timings.bytesReceived, std::memory_order_relaxed);
+
+    int64_t connected = timings.connectUs;
+    if (timings.newConnection) {
+        endpoint.phases[static_cast<size_t>(HTTPPhase::DNS)].Record(Elapsed(0, timings.nameLookupUs));
+        endpoint.phases[static_cast<size_t>(HTTPPhase::Connect)].Record(
+            Elapsed(timings.nameLookupUs, timings.connectUs));
+        if (timings.appConnectUs > 0) {
+            endpoint.phases[static_cast<size_t>(HTTPPhase::TLS)].Record(
+                Elapsed(timings.connectUs, timings.appConnectUs));
+            connected = timings.appConnectUs;
+        }
+    }
+    endpoint.phases[static_cast<size_t>(HTTPPhase::Server)].Record(Elapsed(connected, timings.startTransferUs));
+    endpoint.phases[static_cast<size_t>(HTTPPhase::Transfer)].Record(
+        Elapsed(timings.startTransferUs, timings.totalUs));
+    endpoint.phases[static_cast<size_t>(HTTPPhase::Total)].Record(Elapsed(0, timings.totalUs));
+}
+
+void HTTPMetrics::RecordFailure(const std::string& url) {
+    Endpoint& endpoint = Find(url);
+    endpoint.requests.fetch_add(1, std::memory_order_relaxed);
+    endpoint.failures.fetch_add(1, std::memory_order_relaxed);
+}
+
+double HTTPMetrics::QuantileMs(const std::string& url, HTTPPhase phase, double quantile, uint64_t minCount) {
+    HistogramSnapshot histogram = Find(url).phases[static_cast<size_t>(phase)].Snapshot();
+    if (histogram.count == 0 || histogram.count < minCount) {
+        return -1.0;
+    }
+    return histogram.QuantileMs(quantile);
+}
+
+std::vector<EndpointSnapshot> HTTPMetrics::Snapshot() const {
+    std::vector<EndpointSnapshot> snapshots;
+    auto add = [&snapshots](const Endpoint& endpoint) {
+        EndpointSnapshot snapshot;
+        snapshot.endpoint = endpoint.name;
+        snapshot.requests = endpoint.requests.load(std::memory_order_relaxed);
+        snapshot.failures = endpoint.failures.load(std::memory_order_relaxed);
+        snapshot.bytesSent = endpoint.bytesSent.load(std::memory_order_relaxed);
+        snapshot.bytesReceived = endpoint.bytesReceived.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            snapshot.phases[i] = endpoint.phases[i].Snapshot();
+        }
+        snapshots.push_back(std::move(snapshot));
+    };
+
+    for (const auto& slot : slots) {
+        const Endpoint* endpoint = slot.load(std::memory_order_acquire);
+        if (!endpoint) {
+            break;
+        }
+        add(*endpoint);
+    }
+    if (other.requests.load(std::memory_order_relaxed) > 0) {
+        add(other);
+    }
+    return snapshots;
+}
+
+json HTTPMetrics::ToJson() const {
+    json endpoints = json::object();
+    for (const EndpointSnapshot& snapshot : Snapshot()) {
+        json phases = json::object();
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            const HistogramSnapshot& histogram = snapshot.phases[i];
+            json buckets = json::array();
+            for (size_t b = 0; b < HTTP_LATENCY_BUCKETS; b++) {
+                json bucket;
+                bucket["le_ms"] = b + 1 < HTTP_LATENCY_BUCKETS ? json(HTTP_LATENCY_BOUNDS_US[b] / 1000.0)
+                                                               : json("+Inf");
+                bucket["count"] = histogram.buckets[b];
+                buckets.push_back(bucket);
+            }
+            json phase;
+            phase["count"] = histogram.count;
+            phase["sum_ms"] = histogram.sumUs / 1000.0;
+            phase["p50_ms"] = histogram.QuantileMs(0.50);
+            phase["p90_ms"] = histogram.QuantileMs(0.90);
+            phase["p99_ms"] = histogram.QuantileMs(0.99);
+            phase["buckets"] = buckets;
+            phases[HTTPPhaseName(static_cast<HTTPPhase>(i))] = phase;
+        }
+
+        json endpoint;
+        endpoint["requests"] = snapshot.requests;
+        endpoint["failures"] = snapshot.failures;
+        endpoint["bytes_sent"] = snapshot.bytesSent;
+        endpoint["bytes_received"] = snapshot.bytesReceived;
+        endpoint["phases"] = phases;
+        endpoints[snapshot.endpoint] = endpoint;
+    }
+
+    json report;
+    report["endpoints"] = endpoints;
+    return report;
+}
+
+std::string HTTPMetrics::ToPrometheus() const {
+    std::vector<EndpointSnapshot> snapshots = Snapshot();
+    std::string out;
+
+    out += "# HELP loginsys_http_phase_seconds Time spent in each phase of an HTTP request.\n";
+    out += "# TYPE loginsys_http_phase_seconds histogram\n";
+    for (const EndpointSnapshot& snapshot : snapshots) {
+        std::string endpoint = EscapeLabel(snapshot.endpoint);
+        for (size_t i = 0; i < PHASE_COUNT; i++) {
+            const HistogramSnapshot& histogram = snapshot.phases[i];
+            const char* phase = HTTPPhaseName(static_cast<HTTPPhase>(i));
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b + 1 < HTTP_LATENCY_BUCKETS; b++) {
+                cumulative += histogram.buckets[b];
+                AppendFormat(out, "loginsys_http_phase_seconds_bucket{endpoint=\"%s\",phase=\"%s\",le=\"%g\"} %llu\n",
+                             endpoint.c_str(), phase, HTTP_LATENCY_BOUNDS_US[b] / 1e6,
+                             static_cast<unsigned long long>(cumulative));
+            }
+            AppendFormat(out, "loginsys_http_phase_seconds_bucket{endpoint=\"%s\",phase=\"%s\",le=\"+Inf\"} %llu\n",
+                         endpoint.c_str(), phase, static_cast<unsigned long long>(histogram.count));
+            AppendFormat(out, "loginsys_http_phase_seconds_sum{endpoint=\"%s\",phase=\"%s\"} %.6f\n",
+                         endpoint.c_str(), phase, histogram.sumUs / 1e6);
+            AppendFormat(out, "loginsys_http_phase_seconds_count{endpoint=\"%s\",phase=\"%s\"} %llu\n",
+                         endpoint.c_str(), phase, static_cast<unsigned long long>(histogram.count));
+        }
+    }
+
+    struct Counter {
+        const char* name;
+        const char* help;
+        uint64_t EndpointSnapshot::*field;
+    };
+    const Counter counters[] = {
+        {"loginsys_http_requests_total", "HTTP requests completed or failed.", &EndpointSnapshot::requests},
+        {"loginsys_http_failures_total", "HTTP requests that got no response.", &EndpointSnapshot::failures},
+        {"loginsys_http_sent_bytes_total", "Request body bytes sent.", &EndpointSnapshot::bytesSent},
+        {"loginsys_http_received_bytes_total", "Response body bytes received.", &EndpointSnapshot::bytesReceived},
+    };
+    for (const Counter& counter : counters) {
+        AppendFormat(out, "# HELP %s %s\n# TYPE %s counter\n", counter.name, counter.help, counter.name);
+        for (const EndpointSnapshot& snapshot : snapshots) {
+            AppendFormat(out, "%s{endpoint=\"%s\"} %llu\n", counter.name, EscapeLabel(snapshot.endpoint).c_str(),
+                         static_cast<unsigned long long>(snapshot.*counter.field));
+        }
+    }
+    return out;
+}
+
+bool HTTPMetrics::WriteFile(const std::string& path) const {
+    bool prometheus = path.size() >= 5 && path.compare(path.size() - 5, 5, ".prom") == 0;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    if (prometheus) {
+        file << ToPrometheus();
+    } else {
+        file << ToJson().dump(2) << "\n";
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,174 @@
+#include "integrity.h"
+#include "config.h"
+#include "hex.h"
+#include "startup_trace.h"
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include <openssl/evp.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+IntegrityVerifier::IntegrityVerifier() : hasResult(false), lastResult(false) {
+}
+
+IntegrityVerifier& IntegrityVerifier::Instance() {
+    static IntegrityVerifier instance;
+    return instance;
+}
+
+std::string IntegrityVerifier::ExecutablePath() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) {
+        return "LoginSys.exe";
+    }
+    return std::string(path, length);
+#else
+    return "/proc/self/exe";
+#endif
+}
+
+bool IntegrityVerifier::HashFile(const std::string& path, std::string& hexDigest) {
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    if (!ctx || EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) != 1) {
+        EVP_MD_CTX_free(ctx);
+        return false;
+    }
+
+    bool ok = false;
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_t size = static_cast<size_t>(st.st_size);
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, size, MADV_SEQUENTIAL);
+                ok = EVP_DigestUpdate(ctx, mapped, size) == 1;
+                munmap(mapped, size);
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (!ok) {
+        // Streaming fallback for platforms or files that cannot be mapped.
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (file) {
+            std::vector<unsigned char> chunk(INTEGRITY_READ_CHUNK_SIZE);
+            ok = true;
+            size_t read = 0;
+            while ((read = std::fread(chunk.data(), 1, chunk.size(), file)) > 0) {
+                if (EVP_DigestUpdate(ctx, chunk.data(), read) != 1) {
+                    ok = false;
+                    break;
+                }
+            }
+            if (std::ferror(file)) {
+                ok = false;
+            }
+            std::fclose(file);
+        }
+    }
+
+    unsigned char hash[EVP_MAX_MD_SIZE];
+    unsigned int hashLength = 0;
+    if (ok && EVP_DigestFinal_ex(ctx, hash, &hashLength) != 1) {
+        ok = false;
+    }
+    EVP_MD_CTX_free(ctx);
+
+    if (!ok) {
+        return false;
+    }
+
+    hexDigest = HexEncode(hash, hashLength);
+    return true;
+}
+
+bool IntegrityVerifier::Run() {
+#ifdef ENABLE_INTEGRITY_CHECK
+    StartupTrace::Instance().NameThread("integrity");
+    StartupTrace::Span span("integrity hash");
+    std::string calculatedChecksum;
+    if (!HashFile(ExecutablePath(), calculatedChecksum)) {
+        std::cerr << "Integrity check failed: cannot read executable" << std::endl;
+        return false;
+    }
+
+    if (calculatedChecksum != EXPECTED_BINARY_CHECKSUM) {
+        std::cerr << "Integrity check failed!" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    return true;
+#endif
+}
+
+void IntegrityVerifier::StartLocked() {
+    pending = std::async(std::launch::async, &IntegrityVerifier::Run).share();
+}
+
+void IntegrityVerifier::Start() {
+#ifdef ENABLE_INTEGRITY_CHECK
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pending.valid() && !hasResult) {
+        StartLocked();
+    }
+#endif
+}
+
+bool IntegrityVerifier::Verify() {
+#ifdef ENABLE_INTEGRITY_CHECK
+    std::shared_future<bool> first;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (pending.valid() &&
+            pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            lastResult = pending.get();
+            hasResult = true;
+            verifiedAt = std::chrono::steady_clock::now();
+            pending = std::shared_future<bool>();
+        }
+
+        if (hasResult) {
+            bool recheckDue = INTEGRITY_RECHECK_INTERVAL > 0 && !pending.valid() &&
+                std::chrono::steady_clock::now() - verifiedAt >= std::chrono::seconds(INTEGRITY_RECHECK_INTERVAL);
+            if (recheckDue) {
+                StartLocked();
+            }
+            return lastResult;
+        }
+
+        if (!pending.valid()) {
+            StartLocked();
+        }
+        first = pending;
+    }
+
+    bool result = first.get();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hasResult) {
+        lastResult = result;
+        hasResult = true;
+        verifiedAt = std::chrono::steady_clock::now();
+    }
+    return lastResult;
+#else
+    return true;
+#endif
+}
@@ -2,40 +2,170 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <GLFW/glfw3.h>
-#include "auth_handler.h"
+#include "auth_worker.h"
+#include "config.h"
+#include "curl_pool.h"
+#include "font_atlas.h"
+#include "http_metrics.h"
+#include "integrity.h"
+#include "render_stats.h"
+#include "session_signature.h"
+#include "startup_trace.h"
+#include <algorithm>
 #include <string>
-#include <thread>
 #include <chrono>
-#include <mutex>
-#include <atomic>
+#include <future>
+#include <memory>
+#include <vector>
+#include <cstring>
 
 const int WINDOW_WIDTH = 900;
 const int WINDOW_HEIGHT = 600;
 
+// On-demand rendering. After anything wakes the loop a few frames are drawn
+// so ImGui can settle hover and layout state; while a text field is focused
+// the loop also wakes often enough to blink the caret.
+const int SETTLE_FRAMES = 3;
+const double CARET_BLINK_INTERVAL = 0.4;
+const double RENDER_STATS_INTERVAL = 5.0;
+// How often the network overlay refreshes while nothing else wakes the loop.
+const double NET_OVERLAY_INTERVAL = 1.0;
+
+// Text sizes the UI uses, baked into the font atlas at startup as multiples
+// of UI_FONT_BASE_SIZE.
+enum UIFont {
+    FONT_BODY,
+    FONT_TITLE,
+    FONT_LABEL,
+    FONT_CAPTION,
+    FONT_FOOTER,
+    FONT_COUNT
+};
+const float UI_FONT_SCALES[FONT_COUNT] = {1.0f, 2.2f, 0.9f, 0.85f, 0.75f};
+
+static bool redrawRequested = true;
+
+static void RequestRedraw() {
+    redrawRequested = true;
+}
+
 class LoginUI {
 private:
     char username[256] = "";
     char key[256] = "";
-    std::atomic<bool> loginInProgress{false};
+    bool loginInProgress = false;
     std::string errorMessage = "";
     std::string statusMessage = "";
-    AuthHandler authHandler;
-    std::atomic<bool> isLoggedIn{false};
-    std::mutex messageMutex;
-    std::thread loginThread;
-    std::atomic<bool> shutdownRequested{false};
+    bool isLoggedIn = false;
+    bool sessionResumed = false;
+    std::vector<ImFont*> fonts;
+    AuthWorker authWorker;
+    bool preconnectSent = false;
+    std::chrono::steady_clock::time_point preconnectSentAt;
+    bool reportStats = false;
+
+    void Apply(const AuthCompletion& completion) {
+        switch (completion.type) {
+            case AuthTaskType::Login:
+                loginInProgress = false;
+                statusMessage = "";
+                if (completion.success) {
+                    isLoggedIn = true;
+                    errorMessage = "";
+                    statusMessage = "Login successful!";
+                    ReportPreconnect();
+                } else {
+                    errorMessage = completion.message;
+                }
+                break;
+            case AuthTaskType::Resume:
+                loginInProgress = false;
+                statusMessage = "";
+                if (completion.success) {
+                    sessionResumed = true;
+                    isLoggedIn = true;
+                    statusMessage = "Welcome back, " + completion.username + "!";
+                }
+                break;
+            case AuthTaskType::SessionLost:
+                isLoggedIn = false;
+                statusMessage = "";
+                errorMessage = completion.message;
+                break;
+            case AuthTaskType::CheckSession:
+            case AuthTaskType::Logout:
+            case AuthTaskType::Preconnect:
+                break;
+        }
+    }
+
+    // Starts the DNS/TCP/TLS setup for the login request while the user is
+    // still typing. Repeats only once the previous warm connection may have
+    // been dropped by the server for idling.
+    void WarmConnection() {
+        if (!PRECONNECT_ENABLED || isLoggedIn || loginInProgress) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (preconnectSent && now - preconnectSentAt < std::chrono::seconds(PRECONNECT_REFRESH_SECONDS)) {
+            return;
+        }
+        preconnectSent = true;
+        preconnectSentAt = now;
+        authWorker.Preconnect();
+    }
+
+    // The savings are counted on whichever request first used a warmed
+    // connection, which may be a heartbeat rather than the login itself.
+    void ReportPreconnect() {
+        HTTPConnectionStats connections = HTTPClient::GetConnectionStats();
+        if (!reportStats || connections.preconnects == 0) {
+            return;
+        }
+        fprintf(stderr, "[net] connection warm-up saved %.1f ms across first requests on warmed connections (%llu pre-connects)\n",
+                connections.preconnectSavedMs, connections.preconnects);
+    }
 
 public:
-    LoginUI() : authHandler() {}
-    
-    ~LoginUI() {
-        shutdownRequested.store(true);
-        if (loginThread.joinable()) {
-            loginThread.join();
+    // Worker results wake the render loop out of its wait.
+    LoginUI() : authWorker([]() { glfwPostEmptyEvent(); }) {}
+
+    // Call before GLFW is terminated so the worker no longer posts events to it.
+    void Shutdown() {
+        authWorker.Shutdown();
+    }
+
+    void SetFonts(const std::vector<ImFont*>& uiFonts) {
+        fonts = uiFonts;
+    }
+
+    void SetReportStats(bool enabled) {
+        reportStats = enabled;
+    }
+
+    void ResumeSession() {
+        loginInProgress = true;
+        statusMessage = "Resuming session...";
+        authWorker.Resume();
+    }
+
+    // Applies every finished auth task without blocking. Returns true if the
+    // UI state changed and needs a redraw.
+    bool ProcessCompletions() {
+        bool changed = false;
+        AuthCompletion completion;
+        while (authWorker.PollCompletion(completion)) {
+            Apply(completion);
+            changed = true;
         }
+        return changed;
     }
 
     void Render() {
+        if (!preconnectSent) {
+            WarmConnection();
+        }
+
         ImGuiIO& io = ImGui::GetIO();
         ImGui::SetNextWindowPos(ImVec2(0, 0));
         ImGui::SetNextWindowSize(ImVec2(WINDOW_WIDTH, WINDOW_HEIGHT));
@@ -67,11 +197,11 @@ public:
         
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 0.8f, 1.0f, 1.0f));
         const char* title = "Login Sys";
-        ImGui::SetWindowFontScale(2.2f);
+        ImGui::PushFont(fonts[FONT_TITLE]);
         float titleWidth = ImGui::CalcTextSize(title).x;
         ImGui::SetCursorPosX((panelWidth - titleWidth) * 0.5f);
         ImGui::Text("%s", title);
-        ImGui::SetWindowFontScale(1.0f);
+        ImGui::PopFont();
         ImGui::PopStyleColor();
         
         ImGui::SetCursorPosY(90);
@@ -84,12 +214,12 @@ public:
         
         ImGui::SetCursorPosY(130);
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.5f, 0.5f, 0.55f, 1.0f));
-        ImGui::SetWindowFontScale(0.85f);
+        ImGui::PushFont(fonts[FONT_CAPTION]);
         const char* desc = "Secure Authentication System";
         float descWidth = ImGui::CalcTextSize(desc).x;
         ImGui::SetCursorPosX((panelWidth - descWidth) * 0.5f);
         ImGui::Text("%s", desc);
-        ImGui::SetWindowFontScale(1.0f);
+        ImGui::PopFont();
         ImGui::PopStyleColor();
         
         ImGui::Dummy(ImVec2(0, 20));
@@ -99,9 +229,9 @@ public:
         
         ImGui::SetCursorPosX(inputX);
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.9f, 0.9f, 0.95f, 1.0f));
-        ImGui::SetWindowFontScale(0.9f);
+        ImGui::PushFont(fonts[FONT_LABEL]);
         ImGui::Text("Username");
-        ImGui::SetWindowFontScale(1.0f);
+        ImGui::PopFont();
         ImGui::PopStyleColor();
         
         ImGui::SetCursorPosX(inputX);
@@ -113,14 +243,17 @@ public:
         
         ImGui::PushItemWidth(inputWidth);
         ImGui::InputTextWithHint("##username", "Enter your username", username, IM_ARRAYSIZE(username));
+        if (ImGui::IsItemActivated()) {
+            WarmConnection();
+        }
         
         ImGui::Dummy(ImVec2(0, 8));
         
         ImGui::SetCursorPosX(inputX);
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.9f, 0.9f, 0.95f, 1.0f));
-        ImGui::SetWindowFontScale(0.9f);
+        ImGui::PushFont(fonts[FONT_LABEL]);
         ImGui::Text("License Key");
-        ImGui::SetWindowFontScale(1.0f);
+        ImGui::PopFont();
         ImGui::PopStyleColor();
         
         ImGui::SetCursorPosX(inputX);
@@ -138,7 +271,7 @@ public:
         float buttonX = (panelWidth - buttonWidth) * 0.5f;
         ImGui::SetCursorPosX(buttonX);
         
-        bool loginDisabled = loginInProgress.load() || strlen(username) == 0 || strlen(key) == 0;
+        bool loginDisabled = loginInProgress || strlen(username) == 0 || strlen(key) == 0;
         
         if (loginDisabled) {
             ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(0.25f, 0.25f, 0.3f, 0.6f));
@@ -154,47 +287,43 @@ public:
         
         ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 8.0f);
         
-        if (ImGui::Button(loginInProgress.load() ? "AUTHENTICATING..." : "LOGIN", ImVec2(buttonWidth, buttonHeight)) && !loginDisabled) {
+        if (ImGui::Button(loginInProgress ? "AUTHENTICATING..." : "LOGIN", ImVec2(buttonWidth, buttonHeight)) && !loginDisabled) {
             PerformLogin();
         }
         
         ImGui::PopStyleVar();
         ImGui::PopStyleColor(4);
         
-        {
-            std::lock_guard<std::mutex> lock(messageMutex);
+        if (!errorMessage.empty()) {
+            ImGui::Dummy(ImVec2(0, 8));
+            float msgWidth = ImGui::CalcTextSize(errorMessage.c_str()).x + 30;
+            float msgX = (panelWidth - msgWidth) * 0.5f;
+            ImGui::SetCursorPosX(msgX);
             
-            if (!errorMessage.empty()) {
-                ImGui::Dummy(ImVec2(0, 8));
-                float msgWidth = ImGui::CalcTextSize(errorMessage.c_str()).x + 30;
-                float msgX = (panelWidth - msgWidth) * 0.5f;
-                ImGui::SetCursorPosX(msgX);
-                
-                ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.8f, 0.2f, 0.2f, 0.3f));
-                ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.9f, 0.3f, 0.3f, 0.6f));
-                ImGui::PushStyleVar(ImGuiStyleVar_ChildRounding, 6.0f);
-                
-                ImGui::BeginChild("ErrorBox", ImVec2(msgWidth, 40), true);
-                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
-                ImGui::SetCursorPosY(11);
-                ImGui::SetCursorPosX(15);
-                ImGui::Text("%s", errorMessage.c_str());
-                ImGui::PopStyleColor();
-                ImGui::EndChild();
-                
-                ImGui::PopStyleVar();
-                ImGui::PopStyleColor(2);
-            }
+            ImGui::PushStyleColor(ImGuiCol_ChildBg, ImVec4(0.8f, 0.2f, 0.2f, 0.3f));
+            ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.9f, 0.3f, 0.3f, 0.6f));
+            ImGui::PushStyleVar(ImGuiStyleVar_ChildRounding, 6.0f);
             
-            if (!statusMessage.empty()) {
-                ImGui::Dummy(ImVec2(0, 8));
-                float msgWidth = ImGui::CalcTextSize(statusMessage.c_str()).x;
-                float msgX = (panelWidth - msgWidth) * 0.5f;
-                ImGui::SetCursorPosX(msgX);
-                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 1.0f, 0.6f, 1.0f));
-                ImGui::Text("%s", statusMessage.c_str());
-                ImGui::PopStyleColor();
-            }
+            ImGui::BeginChild("ErrorBox", ImVec2(msgWidth, 40), true);
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.4f, 0.4f, 1.0f));
+            ImGui::SetCursorPosY(11);
+            ImGui::SetCursorPosX(15);
+            ImGui::Text("%s", errorMessage.c_str());
+            ImGui::PopStyleColor();
+            ImGui::EndChild();
+            
+            ImGui::PopStyleVar();
+            ImGui::PopStyleColor(2);
+        }
+        
+        if (!statusMessage.empty()) {
+            ImGui::Dummy(ImVec2(0, 8));
+            float msgWidth = ImGui::CalcTextSize(statusMessage.c_str()).x;
+            float msgX = (panelWidth - msgWidth) * 0.5f;
+            ImGui::SetCursorPosX(msgX);
+            ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 1.0f, 0.6f, 1.0f));
+            ImGui::Text("%s", statusMessage.c_str());
+            ImGui::PopStyleColor();
         }
         
         ImGui::EndChild();
@@ -203,58 +332,170 @@ public:
         
         ImGui::SetCursorPos(ImVec2(10, WINDOW_HEIGHT - 25));
         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.4f, 0.4f, 0.45f, 0.7f));
-        ImGui::SetWindowFontScale(0.75f);
+        ImGui::PushFont(fonts[FONT_FOOTER]);
         ImGui::Text("v1.0.0 | Secure Login System");
-        ImGui::SetWindowFontScale(1.0f);
+        ImGui::PopFont();
         ImGui::PopStyleColor();
 
         ImGui::End();
     }
 
     void PerformLogin() {
-        if (loginThread.joinable()) {
-            loginThread.join();
-        }
+        loginInProgress = true;
+        errorMessage = "";
+        statusMessage = "Validating...";
         
-        loginInProgress.store(true);
-        {
-            std::lock_guard<std::mutex> lock(messageMutex);
-            errorMessage = "";
-            statusMessage = "Validating...";
-        }
-        
-        loginThread = std::thread([this]() {
-            AuthResult result = authHandler.ValidateKey(username, key);
-            
-            if (!shutdownRequested.load()) {
-                std::lock_guard<std::mutex> lock(messageMutex);
-                loginInProgress.store(false);
-                statusMessage = "";
-                
-                if (result.success) {
-                    isLoggedIn.store(true);
-                    errorMessage = "";
-                    statusMessage = "Login successful!";
-                } else {
-                    errorMessage = result.message;
+        // The worker gets copies; ImGui keeps editing the buffers meanwhile.
+        authWorker.Login(username, key);
+    }
+
+    bool IsLoggedIn() const { return isLoggedIn; }
+    bool WasResumed() const { return sessionResumed; }
+
+    void ReportHeartbeat() {
+        HeartbeatStats stats = authWorker.GetHeartbeatStats();
+        long nextIn = stats.nextScheduledAt ? static_cast<long>(stats.nextScheduledAt - std::time(nullptr)) : -1;
+        fprintf(stderr, "[heartbeat] %llu sent, %llu failed, %llu sessions lost, next check in %lds\n",
+                static_cast<unsigned long long>(stats.sent), static_cast<unsigned long long>(stats.failures),
+                static_cast<unsigned long long>(stats.sessionsLost), nextIn);
+    }
+};
+
+// Debug window with per-endpoint request counts and phase latencies from
+// HTTPMetrics. Percentiles are bucket upper bounds.
+static void RenderNetworkOverlay() {
+    ImGui::SetNextWindowPos(ImVec2(WINDOW_WIDTH - 10.0f, 10.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    ImGui::Begin("Network", nullptr,
+        ImGuiWindowFlags_NoDecoration |
+        ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoFocusOnAppearing |
+        ImGuiWindowFlags_NoNav |
+        ImGuiWindowFlags_NoMove);
+
+    std::vector<EndpointSnapshot> endpoints = HTTPMetrics::Instance().Snapshot();
+    if (endpoints.empty()) {
+        ImGui::TextDisabled("No requests yet");
+    }
+    for (const EndpointSnapshot& endpoint : endpoints) {
+        ImGui::Text("%s", endpoint.endpoint.c_str());
+        ImGui::TextDisabled("%llu requests, %llu failed, %.1f KB up, %.1f KB down",
+                            static_cast<unsigned long long>(endpoint.requests),
+                            static_cast<unsigned long long>(endpoint.failures),
+                            endpoint.bytesSent / 1024.0, endpoint.bytesReceived / 1024.0);
+
+        if (ImGui::BeginTable(endpoint.endpoint.c_str(), 4, ImGuiTableFlags_SizingFixedFit)) {
+            ImGui::TableSetupColumn("phase");
+            ImGui::TableSetupColumn("count");
+            ImGui::TableSetupColumn("p50 ms");
+            ImGui::TableSetupColumn("p99 ms");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < static_cast<size_t>(HTTPPhase::Count); i++) {
+                const HistogramSnapshot& phase = endpoint.phases[i];
+                if (phase.count == 0) {
+                    continue;
                 }
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", HTTPPhaseName(static_cast<HTTPPhase>(i)));
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(phase.count));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", phase.QuantileMs(0.50));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", phase.QuantileMs(0.99));
             }
-        });
+            ImGui::EndTable();
+        }
+        ImGui::Spacing();
     }
 
-    bool IsLoggedIn() const { return isLoggedIn.load(); }
-};
+    ImGui::End();
+}
 
 static void glfw_error_callback(int error, const char* description) {
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
 int main(int argc, char** argv) {
+    auto launchTime = std::chrono::steady_clock::now();
+    bool resumeEnabled = true;
+    bool continuousRendering = false;
+    bool reportRenderStats = false;
+    bool reportStartupStats = false;
+    bool showNetOverlay = false;
+    std::string metricsPath;
+    std::string startupTracePath;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-resume") == 0) {
+            resumeEnabled = false;
+        } else if (strcmp(argv[i], "--continuous") == 0) {
+            continuousRendering = true;
+        } else if (strcmp(argv[i], "--render-stats") == 0) {
+            reportRenderStats = true;
+        } else if (strcmp(argv[i], "--startup-stats") == 0) {
+            reportStartupStats = true;
+        } else if (strcmp(argv[i], "--net-overlay") == 0) {
+            showNetOverlay = true;
+        } else if (strcmp(argv[i], "--metrics-file") == 0 && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (strcmp(argv[i], "--startup-trace") == 0 && i + 1 < argc) {
+            startupTracePath = argv[++i];
+        }
+    }
+
+    StartupTrace& trace = StartupTrace::Instance();
+    if (!startupTracePath.empty()) {
+        trace.Enable(launchTime);
+        trace.NameThread("main");
+    }
+
+    // Work that needs neither the window nor the GL context runs on its own
+    // threads while GLFW creates them. AuthHandler picks up the results: the
+    // HWID and curl state are process-wide and block only if still being
+    // built. The integrity hash runs in the background once started.
+    IntegrityVerifier::Instance().Start();
+    std::future<void> networkReady = std::async(std::launch::async, []() {
+        StartupTrace::Instance().NameThread("network init");
+        CurlPool::Instance();
+        SessionVerifier::Instance();
+    });
+    std::future<void> hardwareIdReady = std::async(std::launch::async, []() {
+        StartupTrace::Instance().NameThread("hwid");
+        AuthHandler::HardwareId();
+    });
+
+    std::vector<float> fontSizes;
+    for (float scale : UI_FONT_SCALES) {
+        fontSizes.push_back(UI_FONT_BASE_SIZE * scale);
+    }
+    FontAtlasCache fontCache;
+    FontAtlasStats fontStats;
+    // Before 1.92 an atlas is built without an ImGui context, so it is baked
+    // here and handed to CreateContext. Newer versions need the context and
+    // build on the main thread below. A shared atlas is not owned by the
+    // context, so it is freed here on every way out of main(); fontsReady is
+    // declared after it and so waits for the build before the atlas goes.
+    std::unique_ptr<ImFontAtlas, void (*)(ImFontAtlas*)> sharedFontAtlas(
+        nullptr, [](ImFontAtlas* atlas) { IM_DELETE(atlas); });
+    std::future<std::vector<ImFont*>> fontsReady;
+#if IMGUI_VERSION_NUM < 19200
+    sharedFontAtlas.reset(IM_NEW(ImFontAtlas)());
+    fontsReady = std::async(std::launch::async, [&fontCache, &fontSizes, &fontStats, atlas = sharedFontAtlas.get()]() {
+        StartupTrace::Instance().NameThread("font atlas");
+        StartupTrace::Span span("font atlas");
+        return fontCache.Load(atlas, UI_FONT_FILE, fontSizes, fontStats);
+    });
+#endif
+    
     glfwSetErrorCallback(glfw_error_callback);
     
+    auto phaseStart = StartupTrace::Clock::now();
     if (!glfwInit()) {
         return 1;
     }
+    trace.AddSpan("glfwInit", phaseStart, StartupTrace::Clock::now());
+    phaseStart = StartupTrace::Clock::now();
 
     const char* glsl_version = "#version 130";
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -263,14 +504,23 @@ int main(int argc, char** argv) {
 
     GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Login Sys By @Tgshaitaan", nullptr, nullptr);
     if (window == nullptr) {
+        glfwTerminate();
         return 1;
     }
     
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1);
+    trace.AddSpan("window + GL context", phaseStart, StartupTrace::Clock::now());
+
+    std::vector<ImFont*> uiFonts;
+    if (sharedFontAtlas) {
+        StartupTrace::Span span("wait for font atlas");
+        uiFonts = fontsReady.get();
+    }
 
+    phaseStart = StartupTrace::Clock::now();
     IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
+    ImGui::CreateContext(sharedFontAtlas.get());
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 
@@ -284,19 +534,103 @@ int main(int argc, char** argv) {
     style.Colors[ImGuiCol_TitleBg] = ImVec4(0.08f, 0.08f, 0.12f, 1.0f);
     style.Colors[ImGuiCol_TitleBgActive] = ImVec4(0.08f, 0.08f, 0.12f, 1.0f);
 
+    // Installed before the ImGui backend, which chains to them, so every
+    // input event also schedules a redraw.
+    glfwSetCursorPosCallback(window, [](GLFWwindow*, double, double) { RequestRedraw(); });
+    glfwSetCursorEnterCallback(window, [](GLFWwindow*, int) { RequestRedraw(); });
+    glfwSetMouseButtonCallback(window, [](GLFWwindow*, int, int, int) { RequestRedraw(); });
+    glfwSetScrollCallback(window, [](GLFWwindow*, double, double) { RequestRedraw(); });
+    glfwSetKeyCallback(window, [](GLFWwindow*, int, int, int, int) { RequestRedraw(); });
+    glfwSetCharCallback(window, [](GLFWwindow*, unsigned int) { RequestRedraw(); });
+    glfwSetWindowFocusCallback(window, [](GLFWwindow*, int) { RequestRedraw(); });
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow*) { RequestRedraw(); });
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow*, int, int) { RequestRedraw(); });
+
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
+    trace.AddSpan("imgui init", phaseStart, StartupTrace::Clock::now());
 
+    if (!sharedFontAtlas) {
+        StartupTrace::Span span("font atlas");
+        uiFonts = fontCache.Load(io.Fonts, UI_FONT_FILE, fontSizes, fontStats);
+    }
+    io.FontDefault = uiFonts[FONT_BODY];
+
+    phaseStart = StartupTrace::Clock::now();
     LoginUI loginUI;
+    trace.AddSpan("auth worker", phaseStart, StartupTrace::Clock::now());
+    networkReady.wait();
+    hardwareIdReady.wait();
+    loginUI.SetFonts(uiFonts);
+    loginUI.SetReportStats(reportStartupStats);
+    if (resumeEnabled) {
+        loginUI.ResumeSession();
+    }
+    bool reportedAuthenticated = false;
+    bool reportedFirstFrame = false;
+    RenderStats renderStats(RENDER_STATS_INTERVAL);
+    const char* renderMode = continuousRendering ? "continuous" : "on-demand";
+    int framesToRender = SETTLE_FRAMES;
 
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        if (continuousRendering || framesToRender > 0) {
+            glfwPollEvents();
+        } else {
+            // Sleep until input, a worker's empty event, the next caret blink,
+            // overlay refresh or stats report, whichever comes first.
+            double timeout = io.WantTextInput ? CARET_BLINK_INTERVAL : -1.0;
+            if (showNetOverlay) {
+                timeout = timeout < 0.0 ? NET_OVERLAY_INTERVAL : std::min(timeout, NET_OVERLAY_INTERVAL);
+            }
+            if (reportRenderStats) {
+                double untilReport = renderStats.SecondsUntilReport();
+                timeout = timeout < 0.0 ? untilReport : std::min(timeout, untilReport);
+            }
+            if (timeout < 0.0) {
+                glfwWaitEvents();
+            } else {
+                glfwWaitEventsTimeout(timeout);
+            }
+        }
+
+        if (reportRenderStats && renderStats.SecondsUntilReport() == 0.0) {
+            renderStats.Report(renderMode);
+            loginUI.ReportHeartbeat();
+        }
+
+        bool authStateChanged = loginUI.ProcessCompletions();
+        if (!continuousRendering) {
+            if (redrawRequested || authStateChanged) {
+                redrawRequested = false;
+                framesToRender = SETTLE_FRAMES;
+            } else if (framesToRender == 0 && (io.WantTextInput || showNetOverlay)) {
+                framesToRender = 1;
+            }
+            if (framesToRender == 0) {
+                continue;
+            }
+            framesToRender--;
+        }
+        
+        if (!reportedAuthenticated && loginUI.IsLoggedIn()) {
+            reportedAuthenticated = true;
+            trace.AddMark("authenticated");
+            if (reportStartupStats) {
+                double elapsedMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - launchTime).count();
+                fprintf(stderr, "[startup] cold start to authenticated: %.1f ms (%s)\n", elapsedMs,
+                        loginUI.WasResumed() ? "session resumed" : "interactive login");
+            }
+        }
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         loginUI.Render();
+        if (showNetOverlay) {
+            RenderNetworkOverlay();
+        }
 
         ImGui::Render();
         int display_w, display_h;
@@ -307,14 +641,41 @@ int main(int argc, char** argv) {
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         glfwSwapBuffers(window);
+        renderStats.FrameRendered();
+
+        if (!reportedFirstFrame) {
+            reportedFirstFrame = true;
+            trace.AddMark("first frame");
+            if (reportStartupStats) {
+                double elapsedMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - launchTime).count();
+                fprintf(stderr, "[startup] time to first frame: %.1f ms (font atlas %s in %.1f ms)\n", elapsedMs,
+                        fontStats.cacheHit ? "loaded from cache" : "built", fontStats.milliseconds);
+            }
+        }
     }
 
+    // Aborts any request still in flight rather than waiting out its timeout.
+    auto shutdownStart = std::chrono::steady_clock::now();
+    loginUI.Shutdown();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
+    sharedFontAtlas.reset();
 
     glfwDestroyWindow(window);
     glfwTerminate();
+    if (reportStartupStats) {
+        fprintf(stderr, "[shutdown] window closed to teardown: %.1f ms\n",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shutdownStart).count());
+    }
+
+    if (!metricsPath.empty() && !HTTPMetrics::Instance().WriteFile(metricsPath)) {
+        fprintf(stderr, "Failed to write %s\n", metricsPath.c_str());
+    }
+    if (!startupTracePath.empty() && !trace.WriteFile(startupTracePath)) {
+        fprintf(stderr, "Failed to write %s\n", startupTracePath.c_str());
+    }
 
     return 0;
 }
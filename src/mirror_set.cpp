@@ -0,0 +1,133 @@
+#include "mirror_set.h"
+#include "config.h"
+#include <chrono>
+#include <limits>
+
+namespace {
+
+// Moves `value` towards `sample` by MIRROR_EWMA_ALPHA. A negative value means
+// no sample yet, so the first one is taken as is.
+void UpdateEwma(std::atomic<int64_t>& value, int64_t sample) {
+    int64_t current = value.load(std::memory_order_relaxed);
+    int64_t next;
+    do {
+        next = current < 0 ? sample
+                           : current + static_cast<int64_t>(MIRROR_EWMA_ALPHA * (sample - current));
+    } while (!value.compare_exchange_weak(current, next, std::memory_order_relaxed));
+}
+
+}
+
+MirrorSet::MirrorSet(const std::vector<std::string>& baseUrls) {
+    for (const std::string& url : baseUrls) {
+        if (mirrors.size() == MIRROR_SET_MAX_MIRRORS) {
+            break;
+        }
+        std::string baseUrl = url;
+        while (!baseUrl.empty() && baseUrl.back() == '/') {
+            baseUrl.pop_back();
+        }
+        mirrors.emplace_back(new Mirror(baseUrl));
+    }
+}
+
+int64_t MirrorSet::NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool MirrorSet::IsHealthy(const Mirror& mirror, int64_t nowMs) const {
+    return mirror.consecutiveFailures.load(std::memory_order_relaxed) < MIRROR_MAX_FAILURES ||
+           nowMs - mirror.lastFailureMs.load(std::memory_order_relaxed) >= MIRROR_RETRY_SECONDS * 1000;
+}
+
+int MirrorSet::Match(const std::string& url, std::string& path) const {
+    for (size_t i = 0; i < mirrors.size(); i++) {
+        const std::string& base = mirrors[i]->baseUrl;
+        if (url.compare(0, base.size(), base) == 0 &&
+            (url.size() == base.size() || url[base.size()] == '/' || url[base.size()] == '?')) {
+            path = url.substr(base.size());
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int MirrorSet::Pick(uint32_t tried) const {
+    int64_t nowMs = NowMs();
+    int best = -1;
+    // Healthy and measured, healthy and unmeasured, then unhealthy.
+    int bestRank = 3;
+    double bestScore = std::numeric_limits<double>::max();
+
+    for (size_t i = 0; i < mirrors.size(); i++) {
+        if (tried & (1u << i)) {
+            continue;
+        }
+        const Mirror& mirror = *mirrors[i];
+        int64_t latencyUs = mirror.latencyUs.load(std::memory_order_relaxed);
+        int rank = !IsHealthy(mirror, nowMs) ? 2 : latencyUs < 0 ? 1 : 0;
+        double errorRate = mirror.errorPpm.load(std::memory_order_relaxed) / 1e6;
+        double score = rank == 0 ? latencyUs * (1.0 + MIRROR_ERROR_PENALTY * errorRate) : 0.0;
+
+        if (rank < bestRank || (rank == bestRank && score < bestScore)) {
+            best = static_cast<int>(i);
+            bestRank = rank;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+int MirrorSet::ClaimProbe(int current) {
+    int64_t nowMs = NowMs();
+    for (size_t i = 0; i < mirrors.size(); i++) {
+        if (static_cast<int>(i) == current) {
+            continue;
+        }
+        std::atomic<int64_t>& lastUsed = mirrors[i]->lastUsedMs;
+        int64_t used = lastUsed.load(std::memory_order_relaxed);
+        if (nowMs - used >= MIRROR_PROBE_INTERVAL_SECONDS * 1000 &&
+            lastUsed.compare_exchange_strong(used, nowMs, std::memory_order_relaxed)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void MirrorSet::RecordSuccess(int index, int64_t latencyUs) {
+    Mirror& mirror = *mirrors[index];
+    mirror.requests.fetch_add(1, std::memory_order_relaxed);
+    mirror.consecutiveFailures.store(0, std::memory_order_relaxed);
+    mirror.lastUsedMs.store(NowMs(), std::memory_order_relaxed);
+    UpdateEwma(mirror.latencyUs, latencyUs);
+    UpdateEwma(mirror.errorPpm, 0);
+}
+
+void MirrorSet::RecordFailure(int index) {
+    Mirror& mirror = *mirrors[index];
+    int64_t nowMs = NowMs();
+    mirror.requests.fetch_add(1, std::memory_order_relaxed);
+    mirror.failures.fetch_add(1, std::memory_order_relaxed);
+    mirror.consecutiveFailures.fetch_add(1, std::memory_order_relaxed);
+    mirror.lastFailureMs.store(nowMs, std::memory_order_relaxed);
+    mirror.lastUsedMs.store(nowMs, std::memory_order_relaxed);
+    UpdateEwma(mirror.errorPpm, 1000000);
+}
+
+std::vector<MirrorStats> MirrorSet::Stats() const {
+    int64_t nowMs = NowMs();
+    std::vector<MirrorStats> stats;
+    for (const auto& mirror : mirrors) {
+        MirrorStats entry;
+        entry.baseUrl = mirror->baseUrl;
+        entry.requests = mirror->requests.load(std::memory_order_relaxed);
+        entry.failures = mirror->failures.load(std::memory_order_relaxed);
+        int64_t latencyUs = mirror->latencyUs.load(std::memory_order_relaxed);
+        entry.latencyMs = latencyUs < 0 ? -1.0 : latencyUs / 1000.0;
+        entry.errorRate = mirror->errorPpm.load(std::memory_order_relaxed) / 1e6;
+        entry.healthy = IsHealthy(*mirror, nowMs);
+        stats.push_back(entry);
+    }
+    return stats;
+}
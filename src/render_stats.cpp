@@ -0,0 +1,61 @@
+#include "render_stats.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+RenderStats::RenderStats(double reportIntervalSec)
+    : windowStart(Clock::now()),
+      cpuAtWindowStart(ProcessCpuSeconds()),
+      framesInWindow(0),
+      totalFrames(0),
+      interval(reportIntervalSec) {
+}
+
+double RenderStats::SecondsUntilReport() const {
+    double elapsed = std::chrono::duration<double>(Clock::now() - windowStart).count();
+    return elapsed >= interval ? 0.0 : interval - elapsed;
+}
+
+void RenderStats::Report(const char* mode) {
+    Clock::time_point now = Clock::now();
+    double cpuNow = ProcessCpuSeconds();
+    double elapsed = std::chrono::duration<double>(now - windowStart).count();
+    if (elapsed <= 0.0) {
+        return;
+    }
+
+    fprintf(stderr, "[render] %s: %.1f frames/s, %.1f%% CPU over %.1fs (%llu frames total)\n",
+            mode, framesInWindow / elapsed, (cpuNow - cpuAtWindowStart) / elapsed * 100.0, elapsed,
+            static_cast<unsigned long long>(totalFrames));
+
+    windowStart = now;
+    cpuAtWindowStart = cpuNow;
+    framesInWindow = 0;
+}
+
+double RenderStats::ProcessCpuSeconds() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto toSeconds = [](const FILETIME& time) {
+        ULARGE_INTEGER value;
+        value.LowPart = time.dwLowDateTime;
+        value.HighPart = time.dwHighDateTime;
+        return value.QuadPart / 1e7;
+    };
+    return toSeconds(kernel) + toSeconds(user);
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0.0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
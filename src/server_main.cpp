@@ -0,0 +1,133 @@
+#include "auth_server.h"
+#include "auth_service.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <string>
+#include <ctime>
+
+// Reference backend for the login client. Serves the JSON protocol that
+// AuthHandler expects and doubles as the local stand-in for tests and
+// LoginSysBench.
+
+static void PrintUsage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -p, --port N          listen port (default: 8080)\n"
+        "  -b, --bind ADDR       bind address (default: 0.0.0.0)\n"
+        "  -t, --threads N       event loops, 0 = one per CPU (default: 0)\n"
+        "  -l, --licenses FILE   \"username key [expires_at]\" lines to load\n"
+        "  -d, --data-dir DIR    persist licenses and sessions in DIR (default: memory only)\n"
+        "      --snapshot-interval S\n"
+        "                        seconds between snapshots of DIR (default: 300)\n"
+        "      --session-ttl S   session lifetime in seconds (default: 3600)\n"
+        "      --prefix PATH     URL prefix of the API routes (default: /api)\n"
+        "      --accept-any      accept every username/key (stand-in mode)\n"
+        "      --signing-key FILE\n"
+        "                        Ed25519 private key (PEM) to sign sessions with\n",
+        program);
+}
+
+int main(int argc, char** argv) {
+    AuthServerConfig serverConfig;
+    AuthServiceConfig serviceConfig;
+    std::string licensesPath;
+    long snapshotInterval = 300;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ((arg == "-p" || arg == "--port") && hasValue) {
+            serverConfig.port = std::atoi(argv[++i]);
+        } else if ((arg == "-b" || arg == "--bind") && hasValue) {
+            serverConfig.bindAddress = argv[++i];
+        } else if ((arg == "-t" || arg == "--threads") && hasValue) {
+            serverConfig.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if ((arg == "-l" || arg == "--licenses") && hasValue) {
+            licensesPath = argv[++i];
+        } else if ((arg == "-d" || arg == "--data-dir") && hasValue) {
+            serviceConfig.dataDir = argv[++i];
+        } else if (arg == "--snapshot-interval" && hasValue) {
+            snapshotInterval = std::atol(argv[++i]);
+        } else if (arg == "--session-ttl" && hasValue) {
+            serviceConfig.sessionTtl = std::atol(argv[++i]);
+        } else if (arg == "--prefix" && hasValue) {
+            serviceConfig.pathPrefix = argv[++i];
+        } else if (arg == "--accept-any") {
+            serviceConfig.acceptAny = true;
+        } else if (arg == "--signing-key" && hasValue) {
+            serviceConfig.signingKeyFile = argv[++i];
+        } else {
+            PrintUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    AuthService service(serviceConfig);
+    std::string error;
+
+    auto loadStart = std::chrono::steady_clock::now();
+    if (!service.Open(error)) {
+        fprintf(stderr, "Failed to start: %s\n", error.c_str());
+        return 1;
+    }
+    if (!serviceConfig.dataDir.empty()) {
+        double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+        fprintf(stderr, "Loaded %zu licenses and %zu sessions from %s in %.1f ms\n",
+                service.LicenseCount(), service.SessionCount(), serviceConfig.dataDir.c_str(), loadMs);
+    }
+
+    if (!licensesPath.empty()) {
+        if (!service.LoadLicenses(licensesPath, error)) {
+            fprintf(stderr, "Failed to load licenses: %s\n", error.c_str());
+            return 1;
+        }
+    }
+    if (!serviceConfig.acceptAny && service.LicenseCount() == 0) {
+        fprintf(stderr, "warning: no licenses loaded; every login will fail (use --accept-any for stand-in mode)\n");
+    }
+
+    // Block termination signals before any loop thread starts so only the
+    // main thread receives them through sigwait.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    AuthServer server(serverConfig, service);
+    if (!server.Start(error)) {
+        fprintf(stderr, "Failed to start server: %s\n", error.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "LoginSysServer listening on %s:%d with %u event loops, %zu licenses%s\n",
+            serverConfig.bindAddress.c_str(), serverConfig.port, server.LoopCount(),
+            service.LicenseCount(), serviceConfig.acceptAny ? " (accept-any)" : "");
+
+    // The main thread owns durability: flush the log every second and take
+    // a snapshot on the configured interval.
+    std::time_t lastSnapshot = std::time(nullptr);
+    timespec tick = {1, 0};
+    while (sigtimedwait(&signals, nullptr, &tick) < 0) {
+        service.Sync();
+        if (snapshotInterval > 0 && std::time(nullptr) - lastSnapshot >= snapshotInterval) {
+            if (!service.Snapshot(error)) {
+                fprintf(stderr, "Snapshot failed: %s\n", error.c_str());
+            }
+            lastSnapshot = std::time(nullptr);
+        }
+    }
+
+    fprintf(stderr, "Shutting down\n");
+    server.Stop();
+    server.Wait();
+    if (!service.Snapshot(error)) {
+        fprintf(stderr, "Snapshot failed: %s\n", error.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "session_cache.h"
+#include "config.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'L', 'S', 'S', '1' };
+const int SALT_LENGTH = 16;
+const int IV_LENGTH = 12;
+const int TAG_LENGTH = 16;
+const int KEY_LENGTH = 32;
+const size_t HEADER_LENGTH = sizeof(CACHE_MAGIC) + SALT_LENGTH + IV_LENGTH + TAG_LENGTH;
+
+}
+
+SessionCache::SessionCache() : path(DefaultPath()) {
+}
+
+SessionCache::SessionCache(const std::string& filePath) : path(filePath) {
+}
+
+std::string SessionCache::DefaultPath() {
+#ifdef _WIN32
+    const char* base = std::getenv("APPDATA");
+    std::string dir = base ? base : ".";
+    return dir + "\\" + SESSION_CACHE_FILE_NAME;
+#else
+    const char* base = std::getenv("HOME");
+    std::string dir = base ? base : ".";
+    return dir + "/" + SESSION_CACHE_FILE_NAME;
+#endif
+}
+
+bool SessionCache::DeriveKey(const std::string& hwid, const unsigned char* salt, unsigned char* key) {
+    return PKCS5_PBKDF2_HMAC(hwid.c_str(), static_cast<int>(hwid.length()),
+                             salt, SALT_LENGTH, SESSION_CACHE_KDF_ITERATIONS,
+                             EVP_sha256(), KEY_LENGTH, key) == 1;
+}
+
+bool SessionCache::Save(const PersistedSession& session, const std::string& hwid) const {
+    json payload;
+    payload["username"] = session.username;
+    payload["session_token"] = session.sessionToken;
+    payload["expires_at"] = session.expiresAt;
+    payload["verified_at"] = session.verifiedAt;
+    if (!session.signature.empty()) {
+        payload["signature"] = session.signature;
+    }
+    std::string plaintext = payload.dump();
+
+    unsigned char salt[SALT_LENGTH];
+    unsigned char iv[IV_LENGTH];
+    unsigned char key[KEY_LENGTH];
+    unsigned char tag[TAG_LENGTH];
+
+    if (RAND_bytes(salt, SALT_LENGTH) != 1 || RAND_bytes(iv, IV_LENGTH) != 1) {
+        return false;
+    }
+    if (!DeriveKey(hwid, salt, key)) {
+        return false;
+    }
+
+    std::vector<unsigned char> ciphertext(plaintext.size() + 16);
+    int length = 0;
+    int finalLength = 0;
+    bool ok = false;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx &&
+        EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_LENGTH, nullptr) == 1 &&
+        EVP_EncryptInit_ex(ctx, nullptr, nullptr, key, iv) == 1 &&
+        EVP_EncryptUpdate(ctx, ciphertext.data(), &length,
+                          reinterpret_cast<const unsigned char*>(plaintext.data()),
+                          static_cast<int>(plaintext.size())) == 1 &&
+        EVP_EncryptFinal_ex(ctx, ciphertext.data() + length, &finalLength) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_LENGTH, tag) == 1) {
+        ok = true;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    OPENSSL_cleanse(key, sizeof(key));
+
+    if (!ok) {
+        return false;
+    }
+    ciphertext.resize(length + finalLength);
+
+    // Write to a temporary file and rename so a crash never leaves a
+    // truncated cache behind.
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        out.write(reinterpret_cast<const char*>(salt), SALT_LENGTH);
+        out.write(reinterpret_cast<const char*>(iv), IV_LENGTH);
+        out.write(reinterpret_cast<const char*>(tag), TAG_LENGTH);
+        out.write(reinterpret_cast<const char*>(ciphertext.data()), ciphertext.size());
+        if (!out.good()) {
+            return false;
+        }
+    }
+
+#ifndef _WIN32
+    chmod(tempPath.c_str(), S_IRUSR | S_IWUSR);
+#else
+    std::remove(path.c_str());
+#endif
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool SessionCache::Load(PersistedSession& session, const std::string& hwid) const {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() <= HEADER_LENGTH || std::memcmp(data.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+        return false;
+    }
+
+    const unsigned char* salt = data.data() + sizeof(CACHE_MAGIC);
+    const unsigned char* iv = salt + SALT_LENGTH;
+    unsigned char tag[TAG_LENGTH];
+    std::memcpy(tag, iv + IV_LENGTH, TAG_LENGTH);
+    const unsigned char* ciphertext = data.data() + HEADER_LENGTH;
+    int ciphertextLength = static_cast<int>(data.size() - HEADER_LENGTH);
+
+    unsigned char key[KEY_LENGTH];
+    if (!DeriveKey(hwid, salt, key)) {
+        return false;
+    }
+
+    std::vector<unsigned char> plaintext(ciphertextLength + 16);
+    int length = 0;
+    int finalLength = 0;
+    bool ok = false;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (ctx &&
+        EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, IV_LENGTH, nullptr) == 1 &&
+        EVP_DecryptInit_ex(ctx, nullptr, nullptr, key, iv) == 1 &&
+        EVP_DecryptUpdate(ctx, plaintext.data(), &length, ciphertext, ciphertextLength) == 1 &&
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_LENGTH, tag) == 1 &&
+        EVP_DecryptFinal_ex(ctx, plaintext.data() + length, &finalLength) == 1) {
+        ok = true;
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    OPENSSL_cleanse(key, sizeof(key));
+
+    if (!ok) {
+        return false;
+    }
+
+    try {
+        json payload = json::parse(plaintext.begin(), plaintext.begin() + length + finalLength);
+        session.username = payload.at("username").get<std::string>();
+        session.sessionToken = payload.at("session_token").get<std::string>();
+        session.expiresAt = payload.at("expires_at").get<std::time_t>();
+        session.verifiedAt = payload.at("verified_at").get<std::time_t>();
+        session.signature = payload.value("signature", std::string());
+    } catch (const json::exception&) {
+        return false;
+    }
+
+    return !session.username.empty() && !session.sessionToken.empty();
+}
+
+void SessionCache::Clear() const {
+    std::remove(path.c_str());
+}
@@ -0,0 +1,324 @@
+#include "session_manager.h"
+#include "config.h"
+#include "inflight_window.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+const std::int8_t OUTCOME_PENDING = -2;
+const std::int8_t OUTCOME_FAILED = -1;
+const std::int8_t OUTCOME_INVALID = 0;
+const std::int8_t OUTCOME_VALID = 1;
+
+bool IsMissingRoute(int statusCode) {
+    return statusCode == 404 || statusCode == 405 || statusCode == 501;
+}
+
+// Only a 2xx body says whether a session is valid. Errors such as 429 or
+// 503 come from an overloaded server and must not drop the session.
+bool IsSuccessStatus(int statusCode) {
+    return statusCode >= 200 && statusCode < 300;
+}
+
+}
+
+SessionManager::SessionManager() : SessionManager(API_BASE_URL) {
+}
+
+SessionManager::SessionManager(const std::string& apiBaseUrl)
+    : garbageBytes(0),
+      activeCount(0),
+      batchEndpoint(apiBaseUrl + API_CHECK_SESSION_BATCH_PATH),
+      checkEndpoint(apiBaseUrl + API_CHECK_SESSION_PATH),
+      batchSupported(true) {
+}
+
+SessionManager::StringRef SessionManager::Intern(const std::string& value) {
+    StringRef ref;
+    ref.offset = static_cast<std::uint32_t>(arena.size());
+    ref.length = static_cast<std::uint32_t>(value.size());
+    arena.insert(arena.end(), value.begin(), value.end());
+    return ref;
+}
+
+std::string SessionManager::Lookup(StringRef ref) const {
+    return std::string(arena.data() + ref.offset, ref.length);
+}
+
+void SessionManager::CompactArena() {
+    std::vector<char> compacted;
+    compacted.reserve(arena.size() - garbageBytes);
+
+    for (std::size_t i = 0; i < states.size(); i++) {
+        if (states[i] == SessionState::Free) {
+            continue;
+        }
+        StringRef* refs[2] = { &tokens[i], &usernames[i] };
+        for (StringRef* ref : refs) {
+            std::uint32_t offset = static_cast<std::uint32_t>(compacted.size());
+            compacted.insert(compacted.end(), arena.begin() + ref->offset,
+                             arena.begin() + ref->offset + ref->length);
+            ref->offset = offset;
+        }
+    }
+
+    arena.swap(compacted);
+    garbageBytes = 0;
+}
+
+SessionId SessionManager::Add(const std::string& username, const std::string& sessionToken, std::time_t expires) {
+    StringRef tokenRef = Intern(sessionToken);
+    StringRef usernameRef = Intern(username);
+
+    SessionId id;
+    if (!freeSlots.empty()) {
+        id = freeSlots.back();
+        freeSlots.pop_back();
+        tokens[id] = tokenRef;
+        usernames[id] = usernameRef;
+        expiresAt[id] = expires;
+        states[id] = SessionState::Active;
+    } else {
+        id = static_cast<SessionId>(states.size());
+        tokens.push_back(tokenRef);
+        usernames.push_back(usernameRef);
+        expiresAt.push_back(expires);
+        states.push_back(SessionState::Active);
+    }
+
+    activeCount++;
+    return id;
+}
+
+void SessionManager::Remove(SessionId id) {
+    if (!Contains(id)) {
+        return;
+    }
+
+    garbageBytes += tokens[id].length + usernames[id].length;
+    tokens[id] = StringRef{0, 0};
+    usernames[id] = StringRef{0, 0};
+    states[id] = SessionState::Free;
+    freeSlots.push_back(id);
+    activeCount--;
+
+    if (garbageBytes > arena.size() / 2) {
+        CompactArena();
+    }
+}
+
+void SessionManager::Reserve(std::size_t sessions, std::size_t averageStringBytes) {
+    arena.reserve(sessions * averageStringBytes);
+    tokens.reserve(sessions);
+    usernames.reserve(sessions);
+    expiresAt.reserve(sessions);
+    states.reserve(sessions);
+}
+
+std::size_t SessionManager::Size() const {
+    return activeCount;
+}
+
+bool SessionManager::Contains(SessionId id) const {
+    return id < states.size() && states[id] != SessionState::Free;
+}
+
+SessionState SessionManager::GetState(SessionId id) const {
+    return id < states.size() ? states[id] : SessionState::Free;
+}
+
+std::time_t SessionManager::GetExpiresAt(SessionId id) const {
+    return Contains(id) ? expiresAt[id] : 0;
+}
+
+std::string SessionManager::GetUsername(SessionId id) const {
+    return Contains(id) ? Lookup(usernames[id]) : std::string();
+}
+
+std::string SessionManager::GetSessionToken(SessionId id) const {
+    return Contains(id) ? Lookup(tokens[id]) : std::string();
+}
+
+std::size_t SessionManager::MemoryUsage() const {
+    return arena.capacity() +
+           tokens.capacity() * sizeof(StringRef) +
+           usernames.capacity() * sizeof(StringRef) +
+           expiresAt.capacity() * sizeof(std::time_t) +
+           states.capacity() * sizeof(SessionState) +
+           freeSlots.capacity() * sizeof(SessionId);
+}
+
+json SessionManager::BuildSessionEntry(SessionId id) const {
+    json entry;
+    entry["session_token"] = Lookup(tokens[id]);
+    entry["username"] = Lookup(usernames[id]);
+    return entry;
+}
+
+void SessionManager::SetBatchEnabled(bool enabled) {
+    batchSupported = enabled;
+}
+
+bool SessionManager::IsBatchEnabled() const {
+    return batchSupported;
+}
+
+SessionRefreshStats SessionManager::RefreshAll() {
+    std::vector<SessionId> ids;
+    ids.reserve(activeCount);
+    for (std::size_t i = 0; i < states.size(); i++) {
+        if (states[i] == SessionState::Active) {
+            ids.push_back(static_cast<SessionId>(i));
+        }
+    }
+    return Refresh(ids);
+}
+
+SessionRefreshStats SessionManager::Refresh(const std::vector<SessionId>& ids) {
+    SessionRefreshStats stats = {};
+    stats.checked = ids.size();
+
+    std::vector<std::int8_t> outcome(ids.size(), OUTCOME_PENDING);
+    std::vector<std::time_t> renewedExpiry(ids.size(), 0);
+
+    if (batchSupported) {
+        RefreshBatched(ids, outcome, renewedExpiry, stats);
+    }
+
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        if (outcome[i] == OUTCOME_PENDING) {
+            pending.push_back(i);
+        }
+    }
+    if (!pending.empty()) {
+        RefreshPipelined(ids, pending, outcome, renewedExpiry, stats);
+    }
+
+    for (std::size_t i = 0; i < ids.size(); i++) {
+        SessionId id = ids[i];
+        if (!Contains(id)) {
+            continue;
+        }
+
+        switch (outcome[i]) {
+        case OUTCOME_VALID:
+            stats.valid++;
+            states[id] = SessionState::Active;
+            if (renewedExpiry[i] != 0) {
+                expiresAt[id] = renewedExpiry[i];
+            }
+            break;
+        case OUTCOME_INVALID:
+            stats.invalid++;
+            states[id] = SessionState::Invalid;
+            break;
+        default:
+            stats.failed++;
+            break;
+        }
+    }
+
+    return stats;
+}
+
+void SessionManager::RefreshBatched(const std::vector<SessionId>& ids, std::vector<std::int8_t>& outcome,
+                                    std::vector<std::time_t>& renewedExpiry, SessionRefreshStats& stats) {
+    InFlightWindow window(SESSION_BATCH_IN_FLIGHT);
+    std::mutex flagMutex;
+    bool routeMissing = false;
+
+    for (std::size_t first = 0; first < ids.size(); first += SESSION_BATCH_SIZE) {
+        {
+            std::lock_guard<std::mutex> lock(flagMutex);
+            if (routeMissing) {
+                break;
+            }
+        }
+
+        std::size_t last = std::min(first + SESSION_BATCH_SIZE, ids.size());
+        json sessions = json::array();
+        for (std::size_t i = first; i < last; i++) {
+            sessions.push_back(BuildSessionEntry(ids[i]));
+        }
+        json requestData;
+        requestData["sessions"] = std::move(sessions);
+
+        window.Acquire();
+        stats.requests++;
+        stats.usedBatchEndpoint = true;
+
+        httpClient.PostAsync(batchEndpoint, requestData,
+            [&, first, last](const HTTPResponse& response) {
+                if (response.success && IsMissingRoute(response.statusCode)) {
+                    std::lock_guard<std::mutex> lock(flagMutex);
+                    routeMissing = true;
+                } else if (!response.success || !IsSuccessStatus(response.statusCode)) {
+                    std::fill(outcome.begin() + first, outcome.begin() + last, OUTCOME_FAILED);
+                } else {
+                    try {
+                        json responseData = DecodeBody(response.body, response.format);
+                        const json& results = responseData.at("results");
+                        if (!results.is_array() || results.size() != last - first) {
+                            throw std::runtime_error("result count mismatch");
+                        }
+                        for (std::size_t i = first; i < last; i++) {
+                            const json& entry = results[i - first];
+                            bool valid = entry.contains("valid") && entry["valid"].get<bool>();
+                            outcome[i] = valid ? OUTCOME_VALID : OUTCOME_INVALID;
+                            if (entry.contains("expires_at")) {
+                                renewedExpiry[i] = entry["expires_at"].get<std::time_t>();
+                            }
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Batch session check error: " << e.what() << std::endl;
+                        std::fill(outcome.begin() + first, outcome.begin() + last, OUTCOME_FAILED);
+                    }
+                }
+                window.Release();
+            });
+    }
+
+    window.WaitIdle();
+
+    if (routeMissing) {
+        batchSupported = false;
+    }
+}
+
+void SessionManager::RefreshPipelined(const std::vector<SessionId>& ids, const std::vector<std::size_t>& indices,
+                                      std::vector<std::int8_t>& outcome,
+                                      std::vector<std::time_t>& renewedExpiry, SessionRefreshStats& stats) {
+    InFlightWindow window(SESSION_PIPELINE_DEPTH);
+
+    for (std::size_t i : indices) {
+        json requestData = BuildSessionEntry(ids[i]);
+
+        window.Acquire();
+        stats.requests++;
+
+        httpClient.PostAsync(checkEndpoint, requestData,
+            [&, i](const HTTPResponse& response) {
+                if (!response.success || !IsSuccessStatus(response.statusCode)) {
+                    outcome[i] = OUTCOME_FAILED;
+                } else {
+                    try {
+                        json responseData = DecodeBody(response.body, response.format);
+                        bool valid = responseData.contains("valid") && responseData["valid"].get<bool>();
+                        outcome[i] = valid ? OUTCOME_VALID : OUTCOME_INVALID;
+                        if (responseData.contains("expires_at")) {
+                            renewedExpiry[i] = responseData["expires_at"].get<std::time_t>();
+                        }
+                    } catch (const json::exception& e) {
+                        outcome[i] = OUTCOME_FAILED;
+                    }
+                }
+                window.Release();
+            });
+    }
+
+    window.WaitIdle();
+}
@@ -0,0 +1,116 @@
+#include "session_signature.h"
+#include "config.h"
+#include "hex.h"
+#include <cstdio>
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+
+namespace {
+
+const size_t ED25519_SIGNATURE_LENGTH = 64;
+
+}
+
+std::string SessionSignatureMessage(const std::string& username, const std::string& hwid,
+                                    std::time_t expiresAt, const std::string& sessionToken) {
+    unsigned char tokenHash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(sessionToken.data()), sessionToken.size(), tokenHash);
+
+    std::string message = "loginsys-session-v1\n";
+    message += username;
+    message += '\n';
+    message += hwid;
+    message += '\n';
+    message += std::to_string(static_cast<long long>(expiresAt));
+    message += '\n';
+    message += HexEncode(tokenHash, sizeof(tokenHash));
+    return message;
+}
+
+SessionSigner::SessionSigner() : key(nullptr) {
+}
+
+SessionSigner::~SessionSigner() {
+    EVP_PKEY_free(key);
+}
+
+bool SessionSigner::Load(const std::string& pemPath, std::string& error) {
+    FILE* file = std::fopen(pemPath.c_str(), "r");
+    if (!file) {
+        error = "cannot open " + pemPath;
+        return false;
+    }
+    EVP_PKEY* loaded = PEM_read_PrivateKey(file, nullptr, nullptr, nullptr);
+    std::fclose(file);
+
+    if (!loaded || EVP_PKEY_id(loaded) != EVP_PKEY_ED25519) {
+        EVP_PKEY_free(loaded);
+        error = pemPath + " is not an Ed25519 private key";
+        return false;
+    }
+    EVP_PKEY_free(key);
+    key = loaded;
+    return true;
+}
+
+std::string SessionSigner::Sign(const std::string& message) const {
+    if (!key) {
+        return std::string();
+    }
+
+    unsigned char signature[ED25519_SIGNATURE_LENGTH];
+    size_t length = sizeof(signature);
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    bool ok = ctx &&
+              EVP_DigestSignInit(ctx, nullptr, nullptr, nullptr, key) == 1 &&
+              EVP_DigestSign(ctx, signature, &length,
+                             reinterpret_cast<const unsigned char*>(message.data()), message.size()) == 1;
+    EVP_MD_CTX_free(ctx);
+    return ok ? HexEncode(signature, length) : std::string();
+}
+
+SessionVerifier::SessionVerifier(const std::string& publicKeyPem) : key(nullptr) {
+    if (publicKeyPem.empty()) {
+        return;
+    }
+
+    BIO* bio = BIO_new_mem_buf(publicKeyPem.data(), static_cast<int>(publicKeyPem.size()));
+    if (!bio) {
+        return;
+    }
+    EVP_PKEY* loaded = PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+
+    if (loaded && EVP_PKEY_id(loaded) == EVP_PKEY_ED25519) {
+        key = loaded;
+    } else {
+        EVP_PKEY_free(loaded);
+        fprintf(stderr, "SESSION_SIGNING_PUBLIC_KEY is not an Ed25519 public key; local session checks are off\n");
+    }
+}
+
+SessionVerifier::~SessionVerifier() {
+    EVP_PKEY_free(key);
+}
+
+const SessionVerifier& SessionVerifier::Instance() {
+    static SessionVerifier instance(SESSION_SIGNING_PUBLIC_KEY);
+    return instance;
+}
+
+bool SessionVerifier::Verify(const std::string& message, const std::string& hexSignature) const {
+    unsigned char signature[ED25519_SIGNATURE_LENGTH];
+    if (!key || !HexDecode(hexSignature, signature, sizeof(signature))) {
+        return false;
+    }
+
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    bool ok = ctx &&
+              EVP_DigestVerifyInit(ctx, nullptr, nullptr, nullptr, key) == 1 &&
+              EVP_DigestVerify(ctx, signature, sizeof(signature),
+                               reinterpret_cast<const unsigned char*>(message.data()), message.size()) == 1;
+    EVP_MD_CTX_free(ctx);
+    return ok;
+}
@@ -0,0 +1,105 @@
+#include "startup_trace.h"
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+StartupTrace::Span::Span(const char* spanName)
+    : name(spanName), active(StartupTrace::Instance().IsEnabled()) {
+    if (active) {
+        start = Clock::now();
+    }
+}
+
+StartupTrace::Span::~Span() {
+    if (active) {
+        StartupTrace::Instance().AddSpan(name, start, Clock::now());
+    }
+}
+
+StartupTrace::StartupTrace() : enabled(false), origin(Clock::now()) {
+}
+
+StartupTrace& StartupTrace::Instance() {
+    static StartupTrace instance;
+    return instance;
+}
+
+void StartupTrace::Enable(Clock::time_point traceOrigin) {
+    std::lock_guard<std::mutex> lock(mutex);
+    origin = traceOrigin;
+    enabled = true;
+}
+
+long long StartupTrace::Micros(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+}
+
+int StartupTrace::ThreadIndexLocked() {
+    auto inserted = threads.emplace(std::this_thread::get_id(), static_cast<int>(threads.size()) + 1);
+    if (inserted.second) {
+        threadNames.push_back(std::string());
+    }
+    return inserted.first->second;
+}
+
+void StartupTrace::NameThread(const char* name) {
+    if (!enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    threadNames[ThreadIndexLocked() - 1] = name;
+}
+
+void StartupTrace::AddSpan(const char* name, Clock::time_point start, Clock::time_point end) {
+    if (!enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(Event{name, ThreadIndexLocked(), Micros(start), Micros(end) - Micros(start)});
+}
+
+void StartupTrace::AddMark(const char* name) {
+    if (!enabled) {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(Event{name, ThreadIndexLocked(), Micros(now), -1});
+}
+
+bool StartupTrace::WriteFile(const std::string& path) {
+    json traceEvents = json::array();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < threadNames.size(); i++) {
+            if (!threadNames[i].empty()) {
+                traceEvents.push_back({
+                    { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", i + 1 },
+                    { "args", { { "name", threadNames[i] } } }
+                });
+            }
+        }
+        for (const Event& event : events) {
+            json entry = {
+                { "name", event.name }, { "cat", "startup" }, { "pid", 1 }, { "tid", event.thread },
+                { "ts", event.startUs }
+            };
+            if (event.durationUs < 0) {
+                entry["ph"] = "i";
+                entry["s"] = "g";
+            } else {
+                entry["ph"] = "X";
+                entry["dur"] = event.durationUs;
+            }
+            traceEvents.push_back(entry);
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file << json({ { "traceEvents", traceEvents }, { "displayTimeUnit", "ms" } }).dump(2) << "\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,432 @@
+#include "wire_format.h"
+#include "hex.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+std::string Trim(const std::string& value, size_t begin, size_t end) {
+    while (begin < end && std::isspace(static_cast<unsigned char>(value[begin]))) {
+        begin++;
+    }
+    while (end > begin && std::isspace(static_cast<unsigned char>(value[end - 1]))) {
+        end--;
+    }
+    std::string result = value.substr(begin, end - begin);
+    for (char& c : result) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return result;
+}
+
+bool FromMediaType(const std::string& mediaType, WireFormat& format) {
+    if (mediaType == "application/json") {
+        format = WireFormat::Json;
+    } else if (mediaType == "application/cbor") {
+        format = WireFormat::Cbor;
+    } else if (mediaType == "application/msgpack" || mediaType == "application/x-msgpack" ||
+               mediaType == "application/vnd.msgpack") {
+        format = WireFormat::MsgPack;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+}
+
+const char* WireFormatName(WireFormat format) {
+    switch (format) {
+    case WireFormat::Cbor: return "cbor";
+    case WireFormat::MsgPack: return "msgpack";
+    default: return "json";
+    }
+}
+
+const char* WireFormatContentType(WireFormat format) {
+    switch (format) {
+    case WireFormat::Cbor: return "application/cbor";
+    case WireFormat::MsgPack: return "application/msgpack";
+    default: return "application/json";
+    }
+}
+
+bool WireFormatFromName(const std::string& name, WireFormat& format) {
+    if (name == "json") {
+        format = WireFormat::Json;
+    } else if (name == "cbor") {
+        format = WireFormat::Cbor;
+    } else if (name == "msgpack") {
+        format = WireFormat::MsgPack;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool WireFormatFromContentType(const std::string& contentType, WireFormat& format) {
+    size_t end = contentType.find(';');
+    return FromMediaType(Trim(contentType, 0, end == std::string::npos ? contentType.size() : end), format);
+}
+
+WireFormat NegotiateWireFormat(const std::string& accept) {
+    WireFormat best = WireFormat::Json;
+    double bestQuality = 0.0;
+
+    size_t start = 0;
+    while (start < accept.size()) {
+        size_t end = accept.find(',', start);
+        if (end == std::string::npos) {
+            end = accept.size();
+        }
+
+        size_t paramStart = accept.find(';', start);
+        size_t typeEnd = paramStart < end ? paramStart : end;
+        double quality = 1.0;
+        if (paramStart < end) {
+            std::string params = Trim(accept, paramStart + 1, end);
+            size_t q = params.find("q=");
+            while (q != std::string::npos && q > 0 && params[q - 1] != ';' && params[q - 1] != ' ') {
+                q = params.find("q=", q + 1);
+            }
+            if (q != std::string::npos) {
+                quality = std::atof(params.c_str() + q + 2);
+            }
+        }
+
+        WireFormat format;
+        if (FromMediaType(Trim(accept, start, typeEnd), format) && quality > bestQuality) {
+            best = format;
+            bestQuality = quality;
+        }
+        start = end + 1;
+    }
+    return best;
+}
+
+std::string WireFormatAccept(WireFormat preferred) {
+    if (preferred == WireFormat::Json) {
+        return "application/json";
+    }
+    return std::string(WireFormatContentType(preferred)) + ", application/json;q=0.5";
+}
+
+std::string EncodeBody(const json& document, WireFormat format) {
+    switch (format) {
+    case WireFormat::Cbor: {
+        std::string body;
+        json::to_cbor(document, body);
+        return body;
+    }
+    case WireFormat::MsgPack: {
+        std::string body;
+        json::to_msgpack(document, body);
+        return body;
+    }
+    default:
+        return document.dump();
+    }
+}
+
+json DecodeBody(const std::string& body, WireFormat format) {
+    switch (format) {
+    case WireFormat::Cbor: return json::from_cbor(body);
+    case WireFormat::MsgPack: return json::from_msgpack(body);
+    default: return json::parse(body);
+    }
+}
+
+namespace {
+
+size_t JsonEscapedLength(const std::string& value) {
+    size_t length = 0;
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+            length += 2;
+        } else if (c < 0x20) {
+            length += 6;
+        } else {
+            length += 1;
+        }
+    }
+    return length;
+}
+
+void AppendJsonString(std::string& out, const char* value, size_t length) {
+    out += '"';
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char pair[2];
+                HexEncode(&c, 1, pair);
+                out += "\\u00";
+                out.append(pair, sizeof(pair));
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+// Bytes of the length prefix of a CBOR text string or MessagePack str.
+size_t StringHeaderLength(WireFormat format, size_t length) {
+    if (format == WireFormat::Cbor) {
+        return length <= 23 ? 1 : length <= 0xff ? 2 : length <= 0xffff ? 3 : 5;
+    }
+    return length <= 31 ? 1 : length <= 0xff ? 2 : length <= 0xffff ? 3 : 5;
+}
+
+void AppendBigEndian(std::string& out, uint32_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        out += static_cast<char>((value >> shift) & 0xff);
+    }
+}
+
+void AppendBinaryString(std::string& out, WireFormat format, const char* value, size_t length) {
+    bool cbor = format == WireFormat::Cbor;
+    if (length <= (cbor ? 23u : 31u)) {
+        out += static_cast<char>((cbor ? 0x60 : 0xa0) | length);
+    } else if (length <= 0xff) {
+        out += static_cast<char>(cbor ? 0x78 : 0xd9);
+        AppendBigEndian(out, static_cast<uint32_t>(length), 1);
+    } else if (length <= 0xffff) {
+        out += static_cast<char>(cbor ? 0x79 : 0xda);
+        AppendBigEndian(out, static_cast<uint32_t>(length), 2);
+    } else {
+        out += static_cast<char>(cbor ? 0x7a : 0xdb);
+        AppendBigEndian(out, static_cast<uint32_t>(length), 4);
+    }
+    out.append(value, length);
+}
+
+}
+
+RequestBody::RequestBody() : document(nullptr), fields(), fieldCount(0) {
+}
+
+RequestBody::RequestBody(const json& body) : document(&body), fields(), fieldCount(0) {
+}
+
+RequestBody& RequestBody::Add(const char* name, const std::string& value) {
+    if (fieldCount == MAX_FIELDS) {
+        throw std::length_error("RequestBody holds at most 8 fields");
+    }
+    fields[fieldCount++] = Field{name, std::strlen(name), &value};
+    return *this;
+}
+
+void RequestBody::EncodeTo(WireFormat format, std::string& out) const {
+    if (document) {
+        out = EncodeBody(*document, format);
+        return;
+    }
+
+    // Both binary formats fit MAX_FIELDS in a one-byte map header.
+    size_t size = format == WireFormat::Json ? 2 + (fieldCount > 0 ? fieldCount - 1 : 0) : 1;
+    for (size_t i = 0; i < fieldCount; i++) {
+        const Field& field = fields[i];
+        if (format == WireFormat::Json) {
+            size += 2 + field.nameLength + 1 + 2 + JsonEscapedLength(*field.value);
+        } else {
+            size += StringHeaderLength(format, field.nameLength) + field.nameLength +
+                    StringHeaderLength(format, field.value->size()) + field.value->size();
+        }
+    }
+    out.clear();
+    out.reserve(size);
+
+    switch (format) {
+    case WireFormat::Cbor:
+        out += static_cast<char>(0xa0 | fieldCount);
+        break;
+    case WireFormat::MsgPack:
+        out += static_cast<char>(0x80 | fieldCount);
+        break;
+    default:
+        out += '{';
+    }
+    for (size_t i = 0; i < fieldCount; i++) {
+        const Field& field = fields[i];
+        if (format == WireFormat::Json) {
+            if (i > 0) {
+                out += ',';
+            }
+            AppendJsonString(out, field.name, field.nameLength);
+            out += ':';
+            AppendJsonString(out, field.value->data(), field.value->size());
+        } else {
+            AppendBinaryString(out, format, field.name, field.nameLength);
+            AppendBinaryString(out, format, field.value->data(), field.value->size());
+        }
+    }
+    if (format == WireFormat::Json) {
+        out += '}';
+    }
+}
+
+// SAX handler behind FieldReader::Read. Only values directly inside the
+// top-level object are looked at.
+class FieldReaderSax {
+public:
+    explicit FieldReaderSax(FieldReader& fieldReader) : reader(fieldReader) {}
+
+    bool null() { return Deliver(nullptr, "null"); }
+    bool boolean(bool value) { return Deliver(&value, "boolean"); }
+    bool number_integer(json::number_integer_t value) {
+        int64_t number = value;
+        return Deliver(&number, "number");
+    }
+    bool number_unsigned(json::number_unsigned_t value) {
+        int64_t number = static_cast<int64_t>(value);
+        return Deliver(&number, "number");
+    }
+    bool number_float(json::number_float_t value, const json::string_t&) {
+        int64_t number = static_cast<int64_t>(value);
+        return Deliver(&number, "number");
+    }
+    bool string(json::string_t& value) { return Deliver(&value, "string"); }
+    bool binary(json::binary_t&) { return Deliver(nullptr, "binary"); }
+
+    bool start_object(size_t) { return Open("object"); }
+    bool end_object() { return Close(); }
+    bool start_array(size_t) { return Open("array"); }
+    bool end_array() { return Close(); }
+
+    bool key(json::string_t& name) {
+        current = nullptr;
+        if (depth != 1) {
+            return true;
+        }
+        for (size_t i = 0; i < reader.slotCount; i++) {
+            if (name == reader.slots[i].name) {
+                current = &reader.slots[i];
+            }
+        }
+        return true;
+    }
+
+    template <class Exception>
+    bool parse_error(size_t, const std::string&, const Exception& error) {
+        throw error;
+    }
+
+private:
+    FieldReader& reader;
+    int depth = 0;
+    FieldReader::Slot* current = nullptr;
+
+    bool Open(const char* type) {
+        if (depth == 1 && current) {
+            Deliver(nullptr, type);
+        }
+        depth++;
+        return true;
+    }
+
+    bool Close() {
+        depth--;
+        return true;
+    }
+
+    // `value` points at a bool, int64_t or string matching `type`, or is
+    // null for types no slot can hold.
+    bool Deliver(void* value, const char* type) {
+        FieldReader::Slot* slot = depth == 1 ? current : nullptr;
+        current = nullptr;
+        if (!slot) {
+            return true;
+        }
+
+        bool isBool = std::strcmp(type, "boolean") == 0;
+        bool isNumber = std::strcmp(type, "number") == 0;
+        bool isString = std::strcmp(type, "string") == 0;
+        switch (slot->kind) {
+        case FieldReader::Kind::String:
+            if (!isString) {
+                TypeError("string", type);
+            }
+            static_cast<std::string*>(slot->value)->assign(*static_cast<json::string_t*>(value));
+            break;
+        case FieldReader::Kind::Bool:
+            if (!isBool) {
+                TypeError("boolean", type);
+            }
+            *static_cast<bool*>(slot->value) = *static_cast<bool*>(value);
+            break;
+        case FieldReader::Kind::Integer:
+            if (isBool) {
+                *static_cast<int64_t*>(slot->value) = *static_cast<bool*>(value) ? 1 : 0;
+            } else if (isNumber) {
+                *static_cast<int64_t*>(slot->value) = *static_cast<int64_t*>(value);
+            } else {
+                TypeError("number", type);
+            }
+            break;
+        }
+        slot->found = true;
+        return true;
+    }
+
+    [[noreturn]] static void TypeError(const char* expected, const char* actual) {
+        throw json::type_error::create(302, std::string("type must be ") + expected + ", but is " + actual,
+                                       nullptr);
+    }
+};
+
+FieldReader& FieldReader::Register(const char* name, Kind kind, void* value) {
+    if (slotCount == RequestBody::MAX_FIELDS) {
+        throw std::length_error("FieldReader reads at most 8 fields");
+    }
+    slots[slotCount++] = Slot{name, kind, value, false};
+    return *this;
+}
+
+FieldReader& FieldReader::String(const char* name, std::string& value) {
+    return Register(name, Kind::String, &value);
+}
+
+FieldReader& FieldReader::Bool(const char* name, bool& value) {
+    return Register(name, Kind::Bool, &value);
+}
+
+FieldReader& FieldReader::Integer(const char* name, int64_t& value) {
+    return Register(name, Kind::Integer, &value);
+}
+
+void FieldReader::Read(const std::string& body, WireFormat format) {
+    for (size_t i = 0; i < slotCount; i++) {
+        slots[i].found = false;
+    }
+    FieldReaderSax sax(*this);
+    switch (format) {
+    case WireFormat::Cbor:
+        json::sax_parse(body, &sax, json::input_format_t::cbor);
+        break;
+    case WireFormat::MsgPack:
+        json::sax_parse(body, &sax, json::input_format_t::msgpack);
+        break;
+    default:
+        json::sax_parse(body, &sax);
+    }
+}
+
+bool FieldReader::Has(const char* name) const {
+    for (size_t i = 0; i < slotCount; i++) {
+        if (slots[i].found && std::strcmp(slots[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
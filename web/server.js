@@ -1,13 +1,32 @@
 const express = require('express');
 const path = require('path');
+const crypto = require('crypto');
 const app = express();
 
 app.use(express.json());
 app.use(express.static(path.join(__dirname, 'public')));
 
+// STAND_IN=1 turns this stub into a local stand-in for the C++ client's
+// benchmark: every login succeeds and sessions are tracked in memory.
+const STAND_IN = process.env.STAND_IN === '1';
+const SESSION_TTL_SECONDS = 3600;
+const sessions = new Map();
+
 app.post('/api/validate', async (req, res) => {
     const { username, key, hwid, app_version } = req.body;
     
+    if (STAND_IN) {
+        const token = crypto.randomBytes(32).toString('hex');
+        const expiresAt = Math.floor(Date.now() / 1000) + SESSION_TTL_SECONDS;
+        sessions.set(token, { username, expiresAt });
+        return res.json({
+            success: true,
+            session_token: token,
+            expires_at: expiresAt,
+            message: 'Login successful'
+        });
+    }
+    
     console.log('Login attempt:', { username, hwid, app_version });
     
     res.json({
@@ -16,6 +35,19 @@ app.post('/api/validate', async (req, res) => {
     });
 });
 
+app.post('/api/check-session', (req, res) => {
+    const { session_token, username } = req.body;
+    const session = sessions.get(session_token);
+    const valid = !!session && session.username === username &&
+        session.expiresAt > Math.floor(Date.now() / 1000);
+    res.json(valid ? { valid: true, expires_at: session.expiresAt } : { valid: false });
+});
+
+app.post('/api/logout', (req, res) => {
+    sessions.delete(req.body.session_token);
+    res.json({ success: true });
+});
+
 app.get('/dashboard', (req, res) => {
     res.send(`
         <!DOCTYPE html>